@@ -10,8 +10,10 @@
 #include <string>
 #include <cmath>
 #include <chrono>
+#include <cstdint>
 
 #define LISP_CYCLE 10
+#define LISP_GC_STEP 200 // 每帧增量回收的工作量
 #define LISP_DEBUG 1
 #define FPS 30
 #define GRAVITY -9.8
@@ -27,13 +29,37 @@
 #define COLL_CIR_POLY_BIAS 2e-4
 #define COLL_CO 0.1
 #define ENABLE_SLEEP 1
+#define SLEEP_TIME 0.5
+#define SLEEP_V 0.05
+#define SLEEP_ANGLE_V 0.1
 #define CIRCLE_N 60
+#define BROADPHASE_MARGIN 0.05
+#define BROADPHASE_DISPLACEMENT 4
+#define ARENA_SIZE 0x10000
+#ifndef ENABLE_ALLOC_COUNT
+#define ENABLE_ALLOC_COUNT 0 // 1为统计堆分配次数（替换全局operator new，有开销），可在编译选项中指定
+#endif
+#define HANDLE_INDEX_BITS 32
+#define HANDLE_INDEX_MASK ((1ull << HANDLE_INDEX_BITS) - 1)
 #define PI2 (2 * M_PI)
+#ifndef USE_FLOAT
+#define USE_FLOAT 0 // 1为单精度浮点，可在编译选项中指定
+#endif
+#ifdef _MSC_VER
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
 
 namespace clib {
 
+#if USE_FLOAT
+    using decimal = float; // 浮点类型（单精度，内存带宽减半）
+#else
     using decimal = double; // 浮点类型
-    static const auto inf = std::numeric_limits<decimal>::infinity();
+#endif
+    using c2d_handle = uint64_t; // 物体、关节句柄（0为空句柄）
+    static constexpr auto inf = std::numeric_limits<decimal>::infinity();
 
     // 浮点带倒数
     struct decimal_inv {
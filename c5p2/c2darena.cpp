@@ -0,0 +1,96 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include "c2darena.h"
+
+namespace clib {
+
+    c2d_arena::c2d_arena(size_t capacity) : size(capacity) {
+        data = static_cast<char *>(::operator new(size));
+    }
+
+    c2d_arena::~c2d_arena() {
+        for (auto block : overflow)
+            ::operator delete(block);
+        ::operator delete(data);
+    }
+
+    void *c2d_arena::alloc(size_t n, size_t align) {
+        assert((align & (align - 1)) == 0);
+        auto aligned = (offset + align - 1) & ~(align - 1);
+        if (aligned + n <= size) {
+            offset = aligned + n;
+            return data + aligned;
+        }
+        // 主块不够，申请溢出块（operator new保证最大对齐）
+        auto block = static_cast<char *>(::operator new(n));
+        overflow.push_back(block);
+        overflow_size += n;
+        return block;
+    }
+
+    void c2d_arena::reset() {
+        if (!overflow.empty()) {
+            // 上一帧溢出了，扩大主块，以后不再溢出
+            auto need = offset + overflow_size;
+            for (auto block : overflow)
+                ::operator delete(block);
+            overflow.clear();
+            overflow.shrink_to_fit();
+            overflow_size = 0;
+            ::operator delete(data);
+            size = std::max(size * 2, need + need / 2);
+            data = static_cast<char *>(::operator new(size));
+        }
+        offset = 0;
+    }
+
+    size_t c2d_arena::used() const {
+        return offset + overflow_size;
+    }
+
+    size_t c2d_arena::capacity() const {
+        return size;
+    }
+
+#if ENABLE_ALLOC_COUNT
+    static std::atomic<size_t> alloc_count{0};
+
+    size_t c2d_alloc_count() {
+        return alloc_count.load(std::memory_order_relaxed);
+    }
+#endif
+}
+
+#if ENABLE_ALLOC_COUNT
+// 替换全局分配函数，数组和nothrow版本默认会转到这里
+void *operator new(size_t size) {
+    clib::alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    while (true) {
+        auto p = std::malloc(size);
+        if (p)
+            return p;
+        auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+#endif
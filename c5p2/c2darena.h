@@ -0,0 +1,145 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DARENA_H
+#define CLIB2D_C2DARENA_H
+
+#include <cstddef>
+#include <vector>
+#include "c2d.h"
+
+namespace clib {
+
+    // 线性分配器，每帧开始时重置，存放一帧内的临时数据
+    // 只能整体释放；某帧用量超出容量时临时申请溢出块，下次重置时合并成一块更大的内存
+    // 稳定状态下不再申请堆内存
+    class c2d_arena {
+    public:
+        explicit c2d_arena(size_t capacity = ARENA_SIZE);
+        ~c2d_arena();
+
+        c2d_arena(const c2d_arena &) = delete; // 禁止拷贝
+        c2d_arena &operator=(const c2d_arena &) = delete; // 禁止赋值
+
+        void *alloc(size_t size, size_t align = alignof(std::max_align_t));
+
+        // 释放本帧所有数据
+        void reset();
+
+        size_t used() const; // 本帧用量
+        size_t capacity() const; // 主块容量
+
+    private:
+        char *data{nullptr}; // 主块
+        size_t size{0};
+        size_t offset{0};
+        size_t overflow_size{0}; // 溢出块总大小
+        std::vector<char *> overflow; // 溢出块
+    };
+
+    // STL分配器适配，释放操作为空，内存随分配器重置一起回收
+    template<class T>
+    class c2d_arena_allocator {
+    public:
+        using value_type = T;
+
+        c2d_arena_allocator(c2d_arena &_arena) : arena(&_arena) {}
+
+        template<class U>
+        c2d_arena_allocator(const c2d_arena_allocator<U> &other) : arena(other.arena) {}
+
+        T *allocate(size_t n) {
+            return static_cast<T *>(arena->alloc(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *, size_t) {}
+
+        template<class U>
+        bool operator==(const c2d_arena_allocator<U> &other) const { return arena == other.arena; }
+
+        template<class U>
+        bool operator!=(const c2d_arena_allocator<U> &other) const { return arena != other.arena; }
+
+    private:
+        template<class U> friend class c2d_arena_allocator;
+
+        c2d_arena *arena;
+    };
+
+    template<class T>
+    using c2d_arena_vector = std::vector<T, c2d_arena_allocator<T>>;
+
+    // 定长结点池，释放的结点放入空闲链表以便复用
+    // 用于碰撞表这类频繁插入删除的容器，只有单个对象走结点池，数组（如哈希桶）仍用堆
+    template<class T>
+    class c2d_pool_allocator {
+    public:
+        using value_type = T;
+
+        c2d_pool_allocator() = default;
+
+        template<class U>
+        c2d_pool_allocator(const c2d_pool_allocator<U> &) {}
+
+        T *allocate(size_t n) {
+            if (n != 1)
+                return static_cast<T *>(::operator new(n * sizeof(T)));
+            auto &p = pool();
+            if (!p.free_list) {
+                // 一次申请一批结点串成空闲链表
+                auto chunk = static_cast<slot *>(::operator new(sizeof(slot) * POOL_CHUNK));
+                for (size_t i = 0; i < POOL_CHUNK; ++i) {
+                    chunk[i].next = p.free_list;
+                    p.free_list = &chunk[i];
+                }
+            }
+            auto s = p.free_list;
+            p.free_list = s->next;
+            return reinterpret_cast<T *>(s);
+        }
+
+        void deallocate(T *t, size_t n) {
+            if (n != 1) {
+                ::operator delete(t);
+                return;
+            }
+            auto &p = pool();
+            auto s = reinterpret_cast<slot *>(t);
+            s->next = p.free_list;
+            p.free_list = s;
+        }
+
+        template<class U>
+        bool operator==(const c2d_pool_allocator<U> &) const { return true; }
+
+        template<class U>
+        bool operator!=(const c2d_pool_allocator<U> &) const { return false; }
+
+    private:
+        static const size_t POOL_CHUNK = 64;
+
+        union slot {
+            slot *next;
+            alignas(T) char data[sizeof(T)];
+        };
+
+        struct pool_t {
+            slot *free_list{nullptr};
+        };
+
+        // 每种类型一个池，只在物理线程中使用
+        static pool_t &pool() {
+            static pool_t p;
+            return p;
+        }
+    };
+
+#if ENABLE_ALLOC_COUNT
+    // 统计程序启动以来的堆分配次数（替换全局operator new）
+    size_t c2d_alloc_count();
+#endif
+}
+
+#endif //CLIB2D_C2DARENA_H
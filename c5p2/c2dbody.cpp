@@ -7,9 +7,58 @@
 
 namespace clib {
 
-    c2d_body::c2d_body(uint16_t _id, decimal _mass) : id(_id), mass(_mass) {}
+    c2d_body::c2d_body(c2d_handle _id, decimal _mass) : id(_id), mass(_mass) {}
 
-    v2 c2d_body::rotate(const v2 &v) const {
-        return m2().rotate(angle).rotate(v);
+    c2d_aabb c2d_body::aabb() const {
+        return {min(), max()};
     }
-}
\ No newline at end of file
+
+    void c2d_body::set_angle(decimal a) {
+        angle = a;
+        rot = v2(std::cos(a), std::sin(a));
+    }
+
+    // 乘以exp(i*d)，cos和sin取泰勒展开到三阶后重新归一化
+    // 每步的角度增量很小，这样得到的转角与d相差O(d^5)，又不用每步调用cos和sin
+    void c2d_body::integrate_angle(decimal d) {
+        angle += d;
+        auto d2 = d * d;
+        auto c = 1 - d2 / 2, s = d - d * d2 / 6;
+        rot = v2(rot.x * c - rot.y * s, rot.y * c + rot.x * s);
+        rot = rot * (1 / rot.magnitude());
+    }
+
+#if ENABLE_SLEEP
+    void c2d_body::fall_asleep() {
+        V.x = V.y = 0;
+        angleV = 0;
+        F.x = F.y = 0;
+        Fa.x = Fa.y = 0;
+        M = 0;
+        sleep = true;
+    }
+
+    void c2d_body::wake() {
+        if (!sleep)
+            return;
+        // 沿岛屿链表唤醒所有物体
+        auto body = this;
+        do {
+            auto next = body->island_next;
+            body->sleep = false;
+            body->sleep_time = 0;
+            body->island_next = nullptr;
+            body = next;
+        } while (body && body != this);
+    }
+#endif
+
+    void c2d_body::draw_vectors(c2d_render_batch &batch, const v2 &p, const v2 &dir) const {
+        batch.line(p, v2(p.x + (Fa.x >= 0 ? 0.2 : -0.2) * std::log10(1 + std::abs(Fa.x) * 5),
+                         p.y + (Fa.y >= 0 ? 0.2 : -0.2) * std::log10(1 + std::abs(Fa.y) * 5)),
+                   {0.8f, 0.2f, 0.2f}, 0.6f); // 力向量
+        batch.line(p, p + V * 0.2, {0.0f, 1.0f, 0.0f}, 0.6f); // 速度向量
+        batch.line(p, p + dir * 0.2, {0.2f, 0.2f, 0.2f}, 0.6f); // 方向向量
+        batch.point(p, {0.0f, 1.0f, 0.0f}, 3.0f); // 中心
+    }
+}
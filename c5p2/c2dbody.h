@@ -9,7 +9,8 @@
 #include <memory>
 #include "c2d.h"
 #include "v2.h"
-#include "m2.h"
+#include "c2dbroadphase.h"
+#include "c2drender.h"
 
 namespace clib {
     enum c2d_body_t {
@@ -17,13 +18,14 @@ namespace clib {
         C2D_CIRCLE,
     };
 
+    struct contact_edge;
+    struct joint_edge;
+
     // 刚体基类，由于必然要多态，因此不能用struct
-    // 该类为动态创建，所以要用unique_ptr承担内存管理
+    // 该类由世界的对象池创建和销毁
     class c2d_body {
     public:
-        using ptr = std::unique_ptr<c2d_body>;
-
-        c2d_body(uint16_t _id, decimal _mass);
+        c2d_body(c2d_handle _id, decimal _mass);
 
         c2d_body(const c2d_body &) = delete; // 禁止拷贝
         c2d_body &operator=(const c2d_body &) = delete; // 禁止赋值
@@ -39,14 +41,55 @@ namespace clib {
         virtual v2 min() const = 0; // 下边界
         virtual v2 max() const = 0; // 上边界
 
+        c2d_aabb aabb() const; // 包围盒
+
+        // 射线检测，命中时更新hit并返回true
+        virtual bool raycast(const c2d_ray &ray, c2d_raycast_hit &hit) = 0;
+
         // 分阶段
         // i=0，重置外力
         // i=1，第一阶段：计算速度、角速度
         // i=2，第二阶段，计算位置等其他量
         virtual void update(v2 gravity, int) = 0; // 状态更新
-        virtual void draw() = 0; // 绘制
+        virtual void draw(c2d_render_batch &batch) = 0; // 绘制
+        // 绘制力、速度、方向向量和中心点
+        void draw_vectors(c2d_render_batch &batch, const v2 &p, const v2 &dir) const;
+
+        // 本地坐标旋转到世界坐标，用(cos, sin)计算，不调用三角函数
+        FORCE_INLINE v2 rotate(const v2 &v) const {
+            return {rot.x * v.x - rot.y * v.y, rot.y * v.x + rot.x * v.y};
+        }
+
+        // 世界坐标旋转回本地坐标
+        FORCE_INLINE v2 rotate_inv(const v2 &v) const {
+            return {rot.x * v.x + rot.y * v.y, rot.x * v.y - rot.y * v.x};
+        }
+
+        // 冲量直接作用到速度上（关节求解用），与update(0)、impulse、update(1)的效果相同
+        FORCE_INLINE void apply_impulse(const v2 &p, const v2 &r) {
+            if (statics) return;
+#if ENABLE_SLEEP
+            if (sleep) return;
+#endif
+            V += p * mass.inv;
+            angleV += inertia.inv * r.cross(p);
+        }
 
-        v2 rotate(const v2 &v) const;
+        // 角冲量
+        FORCE_INLINE void apply_angular_impulse(decimal L) {
+            if (statics) return;
+#if ENABLE_SLEEP
+            if (sleep) return;
+#endif
+            angleV += inertia.inv * L;
+        }
+
+        // 求解时的有效质量和转动惯量倒数（静态物体为0）
+        FORCE_INLINE decimal inv_mass() const { return statics ? 0 : mass.inv; }
+        FORCE_INLINE decimal inv_inertia() const { return statics ? 0 : inertia.inv; }
+
+        void set_angle(decimal a); // 设置角度（计算一次三角函数）
+        void integrate_angle(decimal d); // 角度增加d，增量更新旋转
 
         // 以idx为起点，下一顶点为终点的向量
         virtual v2 edge(size_t idx) const = 0;
@@ -57,17 +100,40 @@ namespace clib {
 
         virtual size_t edges() const = 0;
 
+        // 世界坐标顶点按需计算：位置或角度变化后只置dirty，
+        // 等窄检测、查询或绘制真正用到顶点时再变换
+        FORCE_INLINE void sync() const {
+            if (dirty)
+                sync_vertices();
+        }
+
+        virtual void sync_vertices() const = 0; // 重新计算世界坐标顶点，清除dirty
+
+#if ENABLE_SLEEP
+        void fall_asleep(); // 进入休眠，清空速度和受力
+        void wake(); // 唤醒，同时唤醒同一岛屿的所有物体
+#endif
+
         // 不想写那么多get/set，先public用着
 #if ENABLE_SLEEP
         bool sleep{false}; // 是否休眠
+        decimal sleep_time{0}; // 持续静止的时间
+        int island{-1}; // 岛屿编号（构建岛屿时使用）
+        c2d_body *island_next{nullptr}; // 休眠岛屿的环形链表
 #endif
         bool statics{false}; // 是否为静态物体
+        mutable bool dirty{true}; // 世界坐标顶点已过期
         int collision{0}; // 参与碰撞的次数
-        uint16_t id{0}; // ID
+        contact_edge *contact_list{nullptr}; // 接触链表
+        joint_edge *joint_list{nullptr}; // 关节链表
+        size_t list_index{0}; // 在世界物体列表中的下标
+        c2d_handle id{0}; // 句柄
+        int proxy{c2d_broadphase::null_node}; // 宽检测代理
         decimal_inv mass{1}; // 质量
         v2 pos; // 位置（世界坐标，下面未注明均为本地坐标）
         v2 V; // 速度
         decimal angle{0}; // 角度
+        v2 rot{1, 0}; // 旋转（单位复数cos + i*sin）
         decimal angleV{0}; // 角速度
         decimal_inv inertia{0}; // 转动惯量
         decimal f{0.2}; // 滑动/静摩擦系数
@@ -0,0 +1,320 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include <cassert>
+#include <algorithm>
+#include "c2dbroadphase.h"
+
+namespace clib {
+
+    bool c2d_aabb::overlap(const c2d_aabb &other) const {
+        return !(other.min.x > max.x || other.min.y > max.y ||
+                 min.x > other.max.x || min.y > other.max.y);
+    }
+
+    bool c2d_aabb::contains(const c2d_aabb &other) const {
+        return min.x <= other.min.x && min.y <= other.min.y &&
+               other.max.x <= max.x && other.max.y <= max.y;
+    }
+
+    bool c2d_aabb::contains(const v2 &pt) const {
+        return min.x <= pt.x && pt.x <= max.x &&
+               min.y <= pt.y && pt.y <= max.y;
+    }
+
+    decimal c2d_aabb::perimeter() const {
+        return 2 * ((max.x - min.x) + (max.y - min.y));
+    }
+
+    c2d_aabb c2d_aabb::merge(const c2d_aabb &other) const {
+        return {{std::min(min.x, other.min.x), std::min(min.y, other.min.y)},
+                {std::max(max.x, other.max.x), std::max(max.y, other.max.y)}};
+    }
+
+    c2d_aabb c2d_aabb::expand(decimal margin) const {
+        return {min - margin, max + margin};
+    }
+
+    c2d_broadphase::c2d_broadphase() {
+        nodes.reserve(64);
+    }
+
+    int c2d_broadphase::alloc_node() {
+        if (free_list == null_node) {
+            nodes.emplace_back();
+            free_list = (int) nodes.size() - 1;
+            nodes.back().parent = null_node;
+        }
+        auto id = free_list;
+        auto &n = nodes[id];
+        free_list = n.parent;
+        n.parent = n.child1 = n.child2 = null_node;
+        n.height = 0;
+        n.body = nullptr;
+        return id;
+    }
+
+    void c2d_broadphase::free_node(int id) {
+        nodes[id].parent = free_list;
+        nodes[id].height = -1;
+        free_list = id;
+    }
+
+    int c2d_broadphase::create_proxy(const c2d_aabb &aabb, c2d_body *body) {
+        auto id = alloc_node();
+        nodes[id].aabb = aabb.expand(BROADPHASE_MARGIN);
+        nodes[id].body = body;
+        insert_leaf(id);
+        ++proxy_count;
+        return id;
+    }
+
+    void c2d_broadphase::create_proxies(const c2d_aabb *aabbs, c2d_body *const *bodies, int *proxies, size_t count) {
+        if (count == 0)
+            return;
+        nodes.reserve(nodes.size() + 2 * count); // 叶子和子树的内部结点
+        for (size_t i = 0; i < count; ++i) {
+            auto id = alloc_node();
+            nodes[id].aabb = aabbs[i].expand(BROADPHASE_MARGIN);
+            nodes[id].body = bodies[i];
+            proxies[i] = id;
+        }
+        std::vector<int> leaves(proxies, proxies + count);
+        insert_leaf(build(leaves.data(), count));
+        proxy_count += count;
+    }
+
+    // 按包围盒中心在较长的轴上取中位数对半分，建成平衡的子树，返回子树的根
+    int c2d_broadphase::build(int *leaves, size_t count) {
+        if (count == 1)
+            return leaves[0];
+        auto center = [&](int id) { return (nodes[id].aabb.min + nodes[id].aabb.max) * 0.5; };
+        auto lo = center(leaves[0]);
+        auto hi = lo;
+        for (size_t i = 1; i < count; ++i) {
+            auto c = center(leaves[i]);
+            lo = {std::min(lo.x, c.x), std::min(lo.y, c.y)};
+            hi = {std::max(hi.x, c.x), std::max(hi.y, c.y)};
+        }
+        auto axis_x = hi.x - lo.x >= hi.y - lo.y;
+        auto half = count / 2;
+        // 中心相同时再比另一个轴，否则排成一列的物体会被随意分到两边，子树的包围盒大面积重叠
+        std::nth_element(leaves, leaves + half, leaves + count, [&](int a, int b) {
+            auto ca = center(a);
+            auto cb = center(b);
+            if (axis_x)
+                return ca.x < cb.x || (ca.x == cb.x && ca.y < cb.y);
+            return ca.y < cb.y || (ca.y == cb.y && ca.x < cb.x);
+        });
+        auto child1 = build(leaves, half);
+        auto child2 = build(leaves + half, count - half);
+        auto id = alloc_node();
+        auto &n = nodes[id];
+        n.child1 = child1;
+        n.child2 = child2;
+        n.aabb = nodes[child1].aabb.merge(nodes[child2].aabb);
+        n.height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        nodes[child1].parent = id;
+        nodes[child2].parent = id;
+        return id;
+    }
+
+    void c2d_broadphase::destroy_proxy(int proxy) {
+        assert(nodes[proxy].leaf());
+        remove_leaf(proxy);
+        free_node(proxy);
+        --proxy_count;
+    }
+
+    bool c2d_broadphase::move_proxy(int proxy, const c2d_aabb &aabb, const v2 &displacement) {
+        assert(nodes[proxy].leaf());
+        if (nodes[proxy].aabb.contains(aabb))
+            return false;
+        remove_leaf(proxy);
+        // 沿运动方向预测扩大包围盒
+        auto fat = aabb.expand(BROADPHASE_MARGIN);
+        auto d = displacement * BROADPHASE_DISPLACEMENT;
+        if (d.x < 0) fat.min.x += d.x; else fat.max.x += d.x;
+        if (d.y < 0) fat.min.y += d.y; else fat.max.y += d.y;
+        nodes[proxy].aabb = fat;
+        insert_leaf(proxy);
+        return true;
+    }
+
+    c2d_body *c2d_broadphase::body(int proxy) const {
+        return nodes[proxy].body;
+    }
+
+    const c2d_aabb &c2d_broadphase::fat_aabb(int proxy) const {
+        return nodes[proxy].aabb;
+    }
+
+    void c2d_broadphase::insert_leaf(int leaf) {
+        if (root == null_node) {
+            root = leaf;
+            nodes[root].parent = null_node;
+            return;
+        }
+
+        // 按周长启发式找到最合适的兄弟结点
+        auto leaf_aabb = nodes[leaf].aabb;
+        auto index = root;
+        while (!nodes[index].leaf()) {
+            const auto &n = nodes[index];
+            auto child1 = n.child1;
+            auto child2 = n.child2;
+            auto area = n.aabb.perimeter();
+            auto combined_area = n.aabb.merge(leaf_aabb).perimeter();
+            // 新建父结点的代价
+            auto cost = 2 * combined_area;
+            // 往下走的继承代价
+            auto inheritance_cost = 2 * (combined_area - area);
+            auto child_cost = [&](int child) {
+                const auto &c = nodes[child];
+                auto merged = leaf_aabb.merge(c.aabb).perimeter();
+                if (c.leaf())
+                    return merged + inheritance_cost;
+                return merged - c.aabb.perimeter() + inheritance_cost;
+            };
+            auto cost1 = child_cost(child1);
+            auto cost2 = child_cost(child2);
+            if (cost < cost1 && cost < cost2)
+                break;
+            index = cost1 < cost2 ? child1 : child2;
+        }
+
+        auto sibling = index;
+        auto old_parent = nodes[sibling].parent;
+        auto new_parent = alloc_node();
+        nodes[new_parent].parent = old_parent;
+        nodes[new_parent].aabb = leaf_aabb.merge(nodes[sibling].aabb);
+        nodes[new_parent].height = 1 + std::max(nodes[sibling].height, nodes[leaf].height); // 批量插入时leaf是子树
+        nodes[new_parent].child1 = sibling;
+        nodes[new_parent].child2 = leaf;
+        nodes[sibling].parent = new_parent;
+        nodes[leaf].parent = new_parent;
+        if (old_parent != null_node) {
+            if (nodes[old_parent].child1 == sibling)
+                nodes[old_parent].child1 = new_parent;
+            else
+                nodes[old_parent].child2 = new_parent;
+        } else {
+            root = new_parent;
+        }
+
+        // 向上修正包围盒及高度
+        index = nodes[leaf].parent;
+        while (index != null_node) {
+            index = balance(index);
+            auto child1 = nodes[index].child1;
+            auto child2 = nodes[index].child2;
+            nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+            nodes[index].aabb = nodes[child1].aabb.merge(nodes[child2].aabb);
+            index = nodes[index].parent;
+        }
+    }
+
+    void c2d_broadphase::remove_leaf(int leaf) {
+        if (leaf == root) {
+            root = null_node;
+            return;
+        }
+        auto parent = nodes[leaf].parent;
+        auto grand_parent = nodes[parent].parent;
+        auto sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+        if (grand_parent != null_node) {
+            // 用兄弟结点替换父结点
+            if (nodes[grand_parent].child1 == parent)
+                nodes[grand_parent].child1 = sibling;
+            else
+                nodes[grand_parent].child2 = sibling;
+            nodes[sibling].parent = grand_parent;
+            free_node(parent);
+            auto index = grand_parent;
+            while (index != null_node) {
+                index = balance(index);
+                auto child1 = nodes[index].child1;
+                auto child2 = nodes[index].child2;
+                nodes[index].aabb = nodes[child1].aabb.merge(nodes[child2].aabb);
+                nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+                index = nodes[index].parent;
+            }
+        } else {
+            root = sibling;
+            nodes[sibling].parent = null_node;
+            free_node(parent);
+        }
+    }
+
+    // 旋转使树平衡，返回新的子树根
+    // 参考Box2D：https://github.com/erincatto/Box2D/blob/master/Box2D/Collision/b2DynamicTree.cpp#L381
+    int c2d_broadphase::balance(int iA) {
+        auto &A = nodes[iA];
+        if (A.leaf() || A.height < 2)
+            return iA;
+
+        auto iB = A.child1;
+        auto iC = A.child2;
+        auto bal = nodes[iC].height - nodes[iB].height;
+
+        // 将较高的子树提升上来
+        auto rotate = [&](int iUp, int iDown, bool up_is_child2) -> int {
+            auto &up = nodes[iUp];
+            auto iF = up.child1;
+            auto iG = up.child2;
+
+            up.child1 = iA;
+            up.parent = nodes[iA].parent;
+            nodes[iA].parent = iUp;
+
+            if (up.parent != null_node) {
+                if (nodes[up.parent].child1 == iA)
+                    nodes[up.parent].child1 = iUp;
+                else
+                    nodes[up.parent].child2 = iUp;
+            } else {
+                root = iUp;
+            }
+
+            auto &down = nodes[iDown];
+            auto attach = [&](int keep, int give) {
+                nodes[iUp].child2 = keep;
+                if (up_is_child2) nodes[iA].child2 = give;
+                else nodes[iA].child1 = give;
+                nodes[give].parent = iA;
+                nodes[iA].aabb = down.aabb.merge(nodes[give].aabb);
+                nodes[iUp].aabb = nodes[iA].aabb.merge(nodes[keep].aabb);
+                nodes[iA].height = 1 + std::max(down.height, nodes[give].height);
+                nodes[iUp].height = 1 + std::max(nodes[iA].height, nodes[keep].height);
+            };
+            if (nodes[iF].height > nodes[iG].height)
+                attach(iF, iG);
+            else
+                attach(iG, iF);
+            return iUp;
+        };
+
+        if (bal > 1)
+            return rotate(iC, iB, true);
+        if (bal < -1)
+            return rotate(iB, iC, false);
+        return iA;
+    }
+
+    size_t c2d_broadphase::size() const {
+        return proxy_count;
+    }
+
+    int c2d_broadphase::height() const {
+        return root == null_node ? 0 : nodes[root].height;
+    }
+
+    void c2d_broadphase::clear() {
+        nodes.clear();
+        root = null_node;
+        free_list = null_node;
+        proxy_count = 0;
+    }
+}
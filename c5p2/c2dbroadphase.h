@@ -0,0 +1,197 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DBROADPHASE_H
+#define CLIB2D_C2DBROADPHASE_H
+
+#include <vector>
+#include "c2d.h"
+#include "v2.h"
+
+namespace clib {
+    class c2d_body;
+
+    // 轴对齐包围盒
+    struct c2d_aabb {
+        v2 min, max;
+
+        bool overlap(const c2d_aabb &other) const;
+
+        bool contains(const c2d_aabb &other) const;
+
+        bool contains(const v2 &pt) const;
+
+        decimal perimeter() const;
+
+        c2d_aabb merge(const c2d_aabb &other) const;
+
+        c2d_aabb expand(decimal margin) const;
+    };
+
+    // 射线（origin + t * dir，t ∈ [0, max_t]）
+    struct c2d_ray {
+        v2 origin;
+        v2 dir;
+        decimal max_t{1};
+    };
+
+    // 射线检测结果
+    struct c2d_raycast_hit {
+        c2d_body *body{nullptr}; // 命中的物体，nullptr为未命中
+        v2 point; // 命中点
+        v2 normal; // 命中面法线
+        decimal t{0}; // 射线参数
+    };
+
+    // 宽检测-动态AABB树
+    // 参考Box2D：https://github.com/erincatto/Box2D/blob/master/Box2D/Collision/b2DynamicTree.h
+    // 叶子结点保存物体的“肥”包围盒，物体小幅移动时不需要更新树
+    class c2d_broadphase {
+    public:
+        c2d_broadphase();
+
+        c2d_broadphase(const c2d_broadphase &) = delete; // 禁止拷贝
+        c2d_broadphase &operator=(const c2d_broadphase &) = delete; // 禁止赋值
+
+        // 添加物体，返回代理ID
+        int create_proxy(const c2d_aabb &aabb, c2d_body *body);
+
+        // 批量添加物体，proxies[i]对应bodies[i]
+        // 新物体先自顶向下建成一棵平衡的子树，再整体插入，比逐个插入少走很多次树
+        void create_proxies(const c2d_aabb *aabbs, c2d_body *const *bodies, int *proxies, size_t count);
+
+        // 删除物体
+        void destroy_proxy(int proxy);
+
+        // 物体移动，只有超出肥包围盒时才重新插入，返回是否重新插入
+        bool move_proxy(int proxy, const c2d_aabb &aabb, const v2 &displacement);
+
+        c2d_body *body(int proxy) const;
+
+        const c2d_aabb &fat_aabb(int proxy) const;
+
+        // 查询与包围盒相交的叶子，callback返回false时终止
+        template<class Callback>
+        void query(const c2d_aabb &aabb, Callback &&callback) const {
+            stack_t stack;
+            stack.push(root);
+            while (!stack.empty()) {
+                auto id = stack.pop();
+                if (id == null_node)
+                    continue;
+                const auto &n = nodes[id];
+                if (!n.aabb.overlap(aabb))
+                    continue;
+                if (n.leaf()) {
+                    if (!callback(id))
+                        return;
+                } else {
+                    stack.push(n.child1);
+                    stack.push(n.child2);
+                }
+            }
+        }
+
+        // 射线检测，callback(ray, proxy)返回新的max_t（0终止，小于0忽略该叶子）
+        // 参考Box2D：https://github.com/erincatto/Box2D/blob/master/Box2D/Collision/b2DynamicTree.h#L192
+        template<class Callback>
+        void raycast(const c2d_ray &ray, Callback &&callback) const {
+            auto max_t = ray.max_t;
+            auto p1 = ray.origin;
+            auto p2 = ray.origin + ray.dir * max_t;
+            auto seg = c2d_aabb{{std::min(p1.x, p2.x), std::min(p1.y, p2.y)},
+                                {std::max(p1.x, p2.x), std::max(p1.y, p2.y)}};
+            // 分离轴：射线的法线
+            auto abs_n = v2(std::abs(ray.dir.y), std::abs(ray.dir.x));
+            auto n = v2(-ray.dir.y, ray.dir.x);
+            stack_t stack;
+            stack.push(root);
+            while (!stack.empty()) {
+                auto id = stack.pop();
+                if (id == null_node)
+                    continue;
+                const auto &node = nodes[id];
+                if (!node.aabb.overlap(seg))
+                    continue;
+                auto c = (node.aabb.min + node.aabb.max) * 0.5;
+                auto h = (node.aabb.max - node.aabb.min) * 0.5;
+                if (std::abs(n.dot(p1 - c)) - abs_n.dot(h) > 0)
+                    continue;
+                if (node.leaf()) {
+                    auto t = callback(ray, id);
+                    if (t == 0)
+                        return;
+                    if (t > 0 && t < max_t) {
+                        max_t = t;
+                        p2 = ray.origin + ray.dir * max_t;
+                        seg = c2d_aabb{{std::min(p1.x, p2.x), std::min(p1.y, p2.y)},
+                                       {std::max(p1.x, p2.x), std::max(p1.y, p2.y)}};
+                    }
+                } else {
+                    stack.push(node.child1);
+                    stack.push(node.child2);
+                }
+            }
+        }
+
+        size_t size() const;
+
+        int height() const;
+
+        void clear();
+
+    public:
+        static const int null_node = -1;
+
+    private:
+        struct node {
+            c2d_aabb aabb; // 肥包围盒
+            c2d_body *body{nullptr}; // 叶子对应的物体
+            int parent{null_node}; // 父结点（空闲时为下一个空闲结点）
+            int child1{null_node};
+            int child2{null_node};
+            int height{-1}; // 叶子为0，空闲为-1
+
+            bool leaf() const { return child1 == null_node; }
+        };
+
+        // 遍历用的栈，较小时不申请堆内存
+        struct stack_t {
+            int fixed[128];
+            std::vector<int> grow;
+            size_t count{0};
+
+            void push(int id) {
+                if (count < 128) fixed[count] = id;
+                else grow.push_back(id);
+                ++count;
+            }
+
+            int pop() {
+                --count;
+                if (count < 128) return fixed[count];
+                auto id = grow.back();
+                grow.pop_back();
+                return id;
+            }
+
+            bool empty() const { return count == 0; }
+        };
+
+        int alloc_node();
+        void free_node(int id);
+        void insert_leaf(int leaf);
+        int build(int *leaves, size_t count);
+        void remove_leaf(int leaf);
+        int balance(int id);
+
+        std::vector<node> nodes;
+        int root{null_node};
+        int free_list{null_node};
+        size_t proxy_count{0};
+    };
+}
+
+#endif //CLIB2D_C2DBROADPHASE_H
@@ -3,13 +3,12 @@
 // Created by bajdcc
 //
 
-#include <GL/freeglut.h>
 #include "c2dcircle.h"
 #include "c2dworld.h"
 
 namespace clib {
 
-    c2d_circle::c2d_circle(uint16_t _id, decimal _mass, decimal _r)
+    c2d_circle::c2d_circle(c2d_handle _id, decimal _mass, decimal _r)
         : c2d_body(_id, _mass), r(_r) {
         init();
     }
@@ -57,6 +56,26 @@ namespace clib {
         return pos + r.value;
     }
 
+    // 参考Box2D：https://github.com/erincatto/Box2D/blob/master/Box2D/Collision/Shapes/b2CircleShape.cpp#L48
+    bool c2d_circle::raycast(const c2d_ray &ray, c2d_raycast_hit &hit) {
+        // |origin + t * dir - pos| = r 求最小的非负解t
+        auto s = ray.origin - pos;
+        auto b = s.dot(s) - r.square;
+        auto c = s.dot(ray.dir);
+        auto rr = ray.dir.dot(ray.dir);
+        auto sigma = c * c - rr * b;
+        if (sigma < 0 || rr < EPSILON)
+            return false;
+        auto a = -(c + std::sqrt(sigma));
+        if (a < 0 || a > ray.max_t * rr)
+            return false;
+        hit.body = this;
+        hit.t = a / rr;
+        hit.point = ray.origin + ray.dir * hit.t;
+        hit.normal = (hit.point - pos).normalize();
+        return true;
+    }
+
     void c2d_circle::update(v2 gravity, int n) {
         if (statics) return;
 #if ENABLE_SLEEP
@@ -98,10 +117,8 @@ namespace clib {
 
     void c2d_circle::pass2() {
         pos += V * c2d_world::dt;
-        angle += angleV * c2d_world::dt;
-        for (size_t i = 0; i < vertices.size(); ++i) {
-            verticesWorld[i] = vertices[i] + pos; // 本地坐标转换为世界坐标
-        }
+        integrate_angle(angleV * c2d_world::dt);
+        dirty = true; // 顶点等用到时再变换
     }
 
     void c2d_circle::pass3(const v2 &gravity) {
@@ -115,15 +132,11 @@ namespace clib {
 
     void c2d_circle::pass5() {
 #if ENABLE_SLEEP
-        // 当合外力和速度为零时，判定休眠
-        if (Fa.zero(EPSILON_FORCE) && V.zero(EPSILON_V) && std::abs(angleV) < EPSILON_ANGLE_V) {
-            V.x = 0;
-            V.y = 0;
-            angleV = 0;
-            pass0();
-            pass4();
-            collision = 0;
-            sleep = true;
+        // 当速度和角速度足够小时，判定静止
+        if (V.zero(SLEEP_V) && std::abs(angleV) < SLEEP_ANGLE_V) {
+            sleep_time += c2d_world::dt; // 累计静止时间，由所在岛屿统一判定休眠
+        } else {
+            sleep_time = 0;
         }
 #endif
     }
@@ -133,93 +146,30 @@ namespace clib {
         angleV += inertia.inv * (pt - pos).cross(offset);
     }
 
-    void c2d_circle::draw() {
+    void c2d_circle::draw(c2d_render_batch &batch) {
         if (statics) { // 画静态物体
-            glColor3f(0.9f, 0.9f, 0.9f);
-            glBegin(GL_LINE_LOOP);
-            for (auto i = 0; i < CIRCLE_N; i++) {
-                const auto arc = PI2 * i / CIRCLE_N;
-                glVertex2d(pos.x + r.value * std::cos(arc), pos.y + r.value * std::sin(arc));
-            }
-            glEnd();
+            batch.circle(pos, r.value, {0.9f, 0.9f, 0.9f});
             return;
         }
 #if ENABLE_SLEEP
         if (sleep) { // 画休眠物体
-            glColor3f(0.3f, 0.3f, 0.3f);
-            glBegin(GL_LINE_LOOP);
-            for (auto i = 0; i < CIRCLE_N; i++) {
-                const auto arc = PI2 * i / CIRCLE_N;
-                glVertex2d(pos.x + r.value * std::cos(arc), pos.y + r.value * std::sin(arc));
-            }
-            glEnd();
-            glColor3f(0.0f, 1.0f, 0.0f);
-            glPointSize(1.0f);
-            glBegin(GL_POINTS);
-            glVertex2d(pos.x, pos.y); // 中心
-            glEnd();
+            batch.circle(pos, r.value, {0.3f, 0.3f, 0.3f});
+            batch.point(pos, {0.0f, 1.0f, 0.0f}); // 中心
             return;
         }
 #endif
-        // 开启反走样
-        glEnable(GL_BLEND);
-        glEnable(GL_LINE_SMOOTH);
-        glHint(GL_LINE_SMOOTH_HINT, GL_FASTEST);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glColor3f(0.12f, 0.12f, 0.12f); // 坑：所有设置要放begin之前，切记！
-        glBegin(GL_LINE_LOOP);
-        const auto boundMin = pos - r.value;
-        const auto boundMax = pos + r.value;
-        glVertex2d(boundMin.x, boundMin.y);
-        glVertex2d(boundMin.x, boundMax.y);
-        glVertex2d(boundMax.x, boundMax.y);
-        glVertex2d(boundMax.x, boundMin.y);
-        glEnd();
-        if (collision > 0)
-            glColor3f(0.8f, 0.2f, 0.4f);
-        else
-            glColor3f(0.8f, 0.8f, 0.0f);
-        glBegin(GL_LINE_LOOP);
-        for (auto i = 0; i < CIRCLE_N; i++) {
-            const auto arc = PI2 * i / CIRCLE_N;
-            glVertex2d(pos.x + r.value * std::cos(arc), pos.y + r.value * std::sin(arc));
-        }
-        glEnd();
-        // 这里默认物体是中心对称的，重心就是中心，后面会计算重心
-        auto p = pos;
-        auto v = p + V * 0.2;
-        glLineWidth(0.6f);
-        glColor3f(0.8f, 0.2f, 0.2f);
-        glBegin(GL_LINES);
-        glVertex2d(p.x, p.y);
-        glVertex2d(p.x + (Fa.x >= 0 ? 0.2 : -0.2) * std::log10(1 + std::abs(Fa.x) * 5),
-                   p.y + (Fa.y >= 0 ? 0.2 : -0.2) * std::log10(1 + std::abs(Fa.y) * 5)); // 力向量
-        glEnd();
-        glColor3f(0.0f, 1.0f, 0.0f);
-        glBegin(GL_LINES);
-        glVertex2d(p.x, p.y);
-        glVertex2d(v.x, v.y); // 速度向量
-        glEnd();
-        glColor3f(0.2f, 0.2f, 0.2f);
-        glBegin(GL_LINES);
-        glVertex2d(p.x, p.y);
-        glVertex2d(p.x + std::cos(angle) * 0.2, p.y + std::sin(angle) * 0.2); // 方向向量
-        glEnd();
-        glColor3f(0.0f, 1.0f, 0.0f);
-        glPointSize(3.0f);
-        glBegin(GL_POINTS);
-        glVertex2d(p.x, p.y); // 中心
-        glEnd();
-        glDisable(GL_BLEND);
-        glDisable(GL_LINE_SMOOTH);
-        glLineWidth(1.0f);
+        batch.rect(pos - r.value, pos + r.value, {0.12f, 0.12f, 0.12f});
+        batch.circle(pos, r.value, collision > 0 ? c2d_color{0.8f, 0.2f, 0.4f} : c2d_color{0.8f, 0.8f, 0.0f});
+        draw_vectors(batch, pos, rot);
     }
 
     v2 c2d_circle::edge(size_t idx) const {
+        sync();
         return verticesWorld[index(idx + 1)] - verticesWorld[index(idx)];
     }
 
     v2 &c2d_circle::vertex(size_t idx) {
+        sync();
         return verticesWorld[index(idx)];
     }
 
@@ -230,4 +180,11 @@ namespace clib {
     size_t c2d_circle::edges() const {
         return verticesWorld.size();
     }
-}
\ No newline at end of file
+
+    void c2d_circle::sync_vertices() const {
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            verticesWorld[i] = vertices[i] + pos; // 本地坐标转换为世界坐标
+        }
+        dirty = false;
+    }
+}
@@ -13,9 +13,7 @@ namespace clib {
 // 圆形刚体（正圆）
     class c2d_circle : public c2d_body {
     public:
-        using ptr = std::unique_ptr<c2d_circle>;
-
-        c2d_circle(uint16_t _id, decimal _mass, decimal _r);
+        c2d_circle(c2d_handle _id, decimal _mass, decimal _r);
 
         bool contains(const v2 &pt) override;
 
@@ -31,6 +29,8 @@ namespace clib {
 
         v2 max() const override;
 
+        bool raycast(const c2d_ray &ray, c2d_raycast_hit &hit) override;
+
         void update(v2 gravity, int n) override;
 
         void pass0();
@@ -48,7 +48,7 @@ namespace clib {
         // 拖拽物体
         void drag(const v2 &pt, const v2 &offset) override;
 
-        void draw() override;
+        void draw(c2d_render_batch &batch) override;
 
         // 以idx为起点，下一顶点为终点的向量
         v2 edge(size_t idx) const override;
@@ -59,8 +59,10 @@ namespace clib {
 
         size_t edges() const override;
 
+        void sync_vertices() const override;
+
         std::vector<v2> vertices; // 多边形的顶点（本地坐标）
-        std::vector<v2> verticesWorld; // 多边形的顶点（世界坐标）
+        mutable std::vector<v2> verticesWorld; // 多边形的顶点（世界坐标，按需计算）
         decimal_square r; // 半径
     };
 }
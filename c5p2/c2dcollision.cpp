@@ -68,7 +68,7 @@ namespace clib {
         return idx;
     }
 
-    size_t clip(std::vector<contact> &out, const std::vector<contact> &in, size_t i, const v2 &p1, const v2 &p2) {
+    size_t clip(contact *out, const contact *in, size_t i, const v2 &p1, const v2 &p2) {
         size_t num_out = 0;
         auto N = (p2 - p1).normal();
         // 计算投影
@@ -102,11 +102,12 @@ namespace clib {
         // 此时要找到B物体中离A物体最近的边
         c.B.polygon.idx = incident_edge(c.N, bodyB);
 
-        decltype(c.contacts) contacts;
-        // 假定两个接触点（即idxB两端点）
-        contacts.emplace_back(bodyB->vertex(c.B.polygon.idx), bodyB->index(c.B.polygon.idx) + 1);
-        contacts.emplace_back(bodyB->vertex(c.B.polygon.idx + 1), bodyB->index(c.B.polygon.idx + 1) + 1);
-        auto tmp = contacts;
+        // 假定两个接触点（即idxB两端点），裁剪用的临时数组放在栈上
+        contact contacts[2] = {
+            {bodyB->vertex(c.B.polygon.idx), bodyB->index(c.B.polygon.idx) + 1},
+            {bodyB->vertex(c.B.polygon.idx + 1), bodyB->index(c.B.polygon.idx + 1) + 1}
+        };
+        contact tmp[2] = {contacts[0], contacts[1]};
 
         // 将idxB线段按bodyA进行多边形裁剪
         for (size_t i = 0; i < bodyA->edges(); ++i) {
@@ -114,7 +115,8 @@ namespace clib {
                 continue;
             if (clip(tmp, contacts, i, bodyA->vertex(i), bodyA->vertex(i + 1)) < 2)
                 return false;
-            contacts = tmp;
+            contacts[0] = tmp[0];
+            contacts[1] = tmp[1];
         }
 
         auto va = bodyA->vertex(c.A.polygon.idx);
@@ -171,4 +173,33 @@ namespace clib {
             }
         }
     }
-}
\ No newline at end of file
+
+    void collision_link(collision &c) {
+        c2d_body *bodies[2] = {c.bodyA, c.bodyB};
+        for (auto i = 0; i < 2; ++i) {
+            auto &edge = c.edges[i];
+            auto body = bodies[i];
+            edge.other = bodies[1 - i];
+            edge.c = &c;
+            edge.prev = nullptr;
+            edge.next = body->contact_list;
+            if (body->contact_list)
+                body->contact_list->prev = &edge;
+            body->contact_list = &edge;
+        }
+    }
+
+    void collision_unlink(collision &c) {
+        for (auto i = 0; i < 2; ++i) {
+            auto &edge = c.edges[i];
+            auto body = c.edges[1 - i].other; // 这条边挂在的物体
+            if (edge.prev)
+                edge.prev->next = edge.next;
+            else
+                body->contact_list = edge.next;
+            if (edge.next)
+                edge.next->prev = edge.prev;
+            edge.prev = edge.next = nullptr;
+        }
+    }
+}
@@ -12,9 +12,38 @@
 #include "c2dcircle.h"
 
 namespace clib {
+    // 接触点列表，两物体间最多两个接触点，直接放在碰撞结构里，不申请堆内存
+    struct contact_list {
+        static const size_t capacity = 2;
+
+        contact *begin() { return data; }
+        contact *end() { return data + count; }
+        const contact *begin() const { return data; }
+        const contact *end() const { return data + count; }
+        contact &operator[](size_t i) { return data[i]; }
+        const contact &operator[](size_t i) const { return data[i]; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        void clear() { count = 0; }
+        void push_back(const contact &c) { if (count < capacity) data[count++] = c; }
+
+    private:
+        contact data[capacity];
+        size_t count{0};
+    };
+
+    struct collision;
+
+    // 接触边，碰撞通过两条边分别挂到两个物体的接触链表上
+    struct contact_edge {
+        c2d_body *other{nullptr}; // 另一个物体
+        collision *c{nullptr}; // 所属碰撞
+        contact_edge *prev{nullptr}, *next{nullptr};
+    };
+
     // 碰撞结构
     struct collision {
-        std::vector<contact> contacts; // 接触点列表
+        contact_list contacts; // 接触点列表
         c2d_body *bodyA{nullptr}, *bodyB{nullptr}; // 碰撞的两个物体
         union intern {
             struct {
@@ -23,6 +52,7 @@ namespace clib {
             } polygon;
         } A{0}, B{0};
         v2 N; // 法线
+        contact_edge edges[2]; // 接触边，建立时edges[0]挂在bodyA上，edges[1]挂在bodyB上
     };
 
     // 碰撞检测-SAT分离轴定理
@@ -43,8 +73,8 @@ namespace clib {
 
     // Sutherland-Hodgman（多边形裁剪）
     // 参考Box2D：https://github.com/erincatto/Box2D/blob/master/Box2D/Collision/b2Collision.cpp#L201
-    size_t clip(std::vector<contact> &out,
-                const std::vector<contact> &in,
+    size_t clip(contact *out,
+                const contact *in,
                 size_t i,
                 const v2 &p1, const v2 &p2);
 
@@ -56,6 +86,12 @@ namespace clib {
 
     // 碰撞计算
     void collision_update(collision &c, const collision &old_c);
+
+    // 把碰撞挂到两个物体的接触链表上（碰撞需已放入碰撞表，地址不再变化）
+    void collision_link(collision &c);
+
+    // 把碰撞从两个物体的接触链表上摘除
+    void collision_unlink(collision &c);
 }
 
 #endif //CLIB2D_C2DCOLLISION_H
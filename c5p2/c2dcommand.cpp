@@ -0,0 +1,108 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2dcommand.h"
+
+namespace clib {
+
+    c2d_command c2d_command::rect(decimal mass, decimal w, decimal h, const v2 &pos, bool statics) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_RECT;
+        cmd.value = mass;
+        cmd.vec = v2(w, h);
+        cmd.pos = pos;
+        cmd.flag = statics;
+        return cmd;
+    }
+
+    c2d_command c2d_command::circle(decimal mass, decimal r, const v2 &pos, bool statics) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_CIRCLE;
+        cmd.value = mass;
+        cmd.vec = v2(r, r);
+        cmd.pos = pos;
+        cmd.flag = statics;
+        return cmd;
+    }
+
+    c2d_command c2d_command::destroy(c2d_handle body) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_DESTROY;
+        cmd.handle = body;
+        return cmd;
+    }
+
+    c2d_command c2d_command::impulse(c2d_handle body, const v2 &p, const v2 &at) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_IMPULSE;
+        cmd.handle = body;
+        cmd.vec = p;
+        cmd.pos = at;
+        return cmd;
+    }
+
+    c2d_command c2d_command::gravity(const v2 &g) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_GRAVITY;
+        cmd.vec = g;
+        return cmd;
+    }
+
+    c2d_command c2d_command::invert_gravity() {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_INVERT_GRAVITY;
+        return cmd;
+    }
+
+    c2d_command c2d_command::scene(int id) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_SCENE;
+        cmd.id = id;
+        return cmd;
+    }
+
+    c2d_command c2d_command::move(const v2 &v) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_MOVE;
+        cmd.vec = v;
+        return cmd;
+    }
+
+    c2d_command c2d_command::rotate(decimal d) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_ROTATE;
+        cmd.value = d;
+        return cmd;
+    }
+
+    c2d_command c2d_command::mouse(const v2 &pt, bool down) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_MOUSE;
+        cmd.pos = pt;
+        cmd.flag = down;
+        return cmd;
+    }
+
+    c2d_command c2d_command::motion(const v2 &pt) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_MOTION;
+        cmd.pos = pt;
+        return cmd;
+    }
+
+    c2d_command c2d_command::pause(bool paused) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_PAUSE;
+        cmd.flag = paused;
+        return cmd;
+    }
+
+    c2d_command c2d_command::call(std::function<void(c2d_world *)> fn) {
+        c2d_command cmd;
+        cmd.type = C2D_CMD_CALL;
+        cmd.fn = std::move(fn);
+        return cmd;
+    }
+}
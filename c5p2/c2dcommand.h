@@ -0,0 +1,60 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DCOMMAND_H
+#define CLIB2D_C2DCOMMAND_H
+
+#include <functional>
+#include "c2d.h"
+#include "v2.h"
+
+namespace clib {
+    class c2d_world;
+
+    enum c2d_command_t {
+        C2D_CMD_NONE,
+        C2D_CMD_RECT, // 生成矩形
+        C2D_CMD_CIRCLE, // 生成圆
+        C2D_CMD_DESTROY, // 删除物体
+        C2D_CMD_IMPULSE, // 施加冲量
+        C2D_CMD_GRAVITY, // 设置重力
+        C2D_CMD_INVERT_GRAVITY, // 开关重力
+        C2D_CMD_SCENE, // 切换场景
+        C2D_CMD_MOVE, // 移动所有物体
+        C2D_CMD_ROTATE, // 旋转所有物体
+        C2D_CMD_MOUSE, // 鼠标按下/抬起
+        C2D_CMD_MOTION, // 鼠标拖动
+        C2D_CMD_PAUSE, // 暂停/继续
+        C2D_CMD_CALL, // 任意操作
+    };
+
+    // 外部对世界的修改，任意线程用c2d_world::post投递，在step()开头统一执行
+    struct c2d_command {
+        c2d_command_t type{C2D_CMD_NONE};
+        v2 pos; // 位置/作用点
+        v2 vec; // 尺寸/冲量/重力/位移
+        decimal value{0}; // 质量/半径/角度
+        c2d_handle handle{0}; // 物体
+        int id{0}; // 场景
+        bool flag{false}; // 静态物体/按下/暂停
+        std::function<void(c2d_world *)> fn;
+
+        static c2d_command rect(decimal mass, decimal w, decimal h, const v2 &pos, bool statics = false);
+        static c2d_command circle(decimal mass, decimal r, const v2 &pos, bool statics = false);
+        static c2d_command destroy(c2d_handle body);
+        static c2d_command impulse(c2d_handle body, const v2 &p, const v2 &at); // at为世界坐标
+        static c2d_command gravity(const v2 &g);
+        static c2d_command invert_gravity();
+        static c2d_command scene(int id);
+        static c2d_command move(const v2 &v);
+        static c2d_command rotate(decimal d);
+        static c2d_command mouse(const v2 &pt, bool down);
+        static c2d_command motion(const v2 &pt);
+        static c2d_command pause(bool paused);
+        static c2d_command call(std::function<void(c2d_world *)> fn);
+    };
+}
+
+#endif //CLIB2D_C2DCOMMAND_H
@@ -13,7 +13,7 @@ namespace clib {
     struct contact {
         v2 pos; // 位置
         v2 ra, rb; // 物体重心到接触点的向量
-        c2d_body_t ta, tb; // 物体的类型
+        c2d_body_t ta{C2D_POLYGON}, tb{C2D_POLYGON}; // 物体的类型
         decimal sep{0}; // 分离投影（重叠距离）
         decimal mass_normal{0};
         decimal mass_tangent{0};
@@ -29,6 +29,8 @@ namespace clib {
             } circle;
         } A{0}, B{0};
 
+        contact() = default;
+
         contact(v2 _pos);
 
         contact(v2 _pos, size_t index);
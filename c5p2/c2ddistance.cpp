@@ -0,0 +1,67 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2ddistance.h"
+#include "c2dworld.h"
+
+namespace clib {
+
+    c2d_joint_t c2d_distance_joint::type() const {
+        return C2D_JOINT_DISTANCE;
+    }
+
+    void c2d_distance_joint::prepare() {
+        static const auto kBiasFactor = 0.2;
+        auto &a = *this->a;
+        auto &b = *this->b;
+        ra = a.rotate(local_anchor_a);
+        rb = b.rotate(local_anchor_b);
+        auto d = b.world() + rb - a.world() - ra;
+        auto len = d.magnitude();
+        u = len > EPSILON ? d / len : v2();
+        auto crA = ra.cross(u);
+        auto crB = rb.cross(u);
+        auto k = a.inv_mass() + b.inv_mass() + a.inv_inertia() * crA * crA + b.inv_inertia() * crB * crB;
+        mass = k > 0 ? 1 / k : 0;
+        bias = kBiasFactor * c2d_world::dt_inv * (len - length);
+
+        // 用上一帧的冲量预热
+        auto P = p * u;
+        a.apply_impulse(-P, ra);
+        b.apply_impulse(P, rb);
+    }
+
+    void c2d_distance_joint::solve() {
+        auto &a = *this->a;
+        auto &b = *this->b;
+        auto dv = (b.V + (-b.angleV * rb.N())) -
+                  (a.V + (-a.angleV * ra.N()));
+        auto lambda = -mass * (u.dot(dv) + bias);
+        p += lambda;
+        auto P = lambda * u;
+        a.apply_impulse(-P, ra);
+        b.apply_impulse(P, rb);
+    }
+
+    void c2d_distance_joint::draw(c2d_render_batch &batch) {
+        auto str = (float) (std::min<decimal>(std::log2(1 + std::abs(p) * c2d_world::dt_inv), 10) * 0.08);
+        batch.line(world_anchor_a(), world_anchor_b(), {0.2f + str, 0.6f, 1 - str});
+    }
+
+    v2 c2d_distance_joint::world_anchor_a() const {
+        return a->rotate(local_anchor_a) + a->world();
+    }
+
+    v2 c2d_distance_joint::world_anchor_b() const {
+        return b->rotate(local_anchor_b) + b->world();
+    }
+
+    c2d_distance_joint::c2d_distance_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b,
+                                           const v2 &anchor_a, const v2 &anchor_b) :
+        c2d_joint(_id, _a, _b), length((anchor_b - anchor_a).magnitude()) {
+        local_anchor_a = a->rotate_inv(anchor_a - a->world());
+        local_anchor_b = b->rotate_inv(anchor_b - b->world());
+    }
+}
@@ -0,0 +1,46 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DDISTANCE_H
+#define CLIB2D_C2DDISTANCE_H
+
+#include "c2djoint.h"
+
+namespace clib {
+    // 距离关节：两个锚点之间保持固定距离（刚性杆）
+    class c2d_distance_joint final : public c2d_joint {
+    public:
+        c2d_joint_t type() const override;
+
+        void prepare(); // 预处理
+
+        void solve(); // 计算
+
+        void draw(c2d_render_batch &batch) override;
+
+        v2 world_anchor_a() const;
+
+        v2 world_anchor_b() const;
+
+        // 锚点为世界坐标，长度取创建时两锚点的距离
+        c2d_distance_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b, const v2 &anchor_a, const v2 &anchor_b);
+
+        c2d_distance_joint(const c2d_distance_joint &) = delete; // 禁止拷贝
+        c2d_distance_joint &operator=(const c2d_distance_joint &) = delete; // 禁止赋值
+
+        v2 local_anchor_a; // 物体A的锚点（本地坐标）
+        v2 local_anchor_b; // 物体B的锚点（本地坐标）
+        decimal length{0}; // 长度
+
+        v2 ra; // 物体A重心到锚点
+        v2 rb; // 物体B重心到锚点
+        v2 u; // A锚点指向B锚点的单位向量
+        decimal mass{0}; // 有效质量
+        decimal bias{0}; // 位置补偿
+        decimal p{0}; // 冲量累计
+    };
+}
+
+#endif //CLIB2D_C2DDISTANCE_H
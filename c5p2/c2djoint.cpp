@@ -7,5 +7,34 @@
 
 namespace clib {
 
-    c2d_joint::c2d_joint(c2d_body *_a, c2d_body *_b) : a(_a), b(_b) {}
+    c2d_joint::c2d_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b) : id(_id), a(_a), b(_b) {}
+
+    void c2d_joint::link() {
+        c2d_body *bodies[2] = {a, b};
+        for (auto i = 0; i < 2; ++i) {
+            auto &edge = edges[i];
+            auto body = bodies[i];
+            edge.other = bodies[1 - i];
+            edge.joint = this;
+            edge.prev = nullptr;
+            edge.next = body->joint_list;
+            if (body->joint_list)
+                body->joint_list->prev = &edge;
+            body->joint_list = &edge;
+        }
+    }
+
+    void c2d_joint::unlink() {
+        c2d_body *bodies[2] = {a, b};
+        for (auto i = 0; i < 2; ++i) {
+            auto &edge = edges[i];
+            if (edge.prev)
+                edge.prev->next = edge.next;
+            else
+                bodies[i]->joint_list = edge.next;
+            if (edge.next)
+                edge.next->prev = edge.prev;
+            edge.prev = edge.next = nullptr;
+        }
+    }
 }
\ No newline at end of file
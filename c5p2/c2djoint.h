@@ -9,21 +9,45 @@
 #include "c2dbody.h"
 
 namespace clib {
+    enum c2d_joint_t {
+        C2D_JOINT_REVOLUTE, // 旋转关节
+        C2D_JOINT_DISTANCE, // 距离关节
+        C2D_JOINT_WELD, // 焊接关节
+        C2D_JOINT_PRISMATIC, // 滑动关节
+        C2D_JOINT_MOTOR, // 马达关节
+        C2D_JOINT_MOUSE, // 鼠标关节
+        C2D_JOINT_TYPES,
+    };
+
+    class c2d_joint;
+
+    // 关节边，关节通过两条边分别挂到两个物体的关节链表上
+    struct joint_edge {
+        c2d_body *other{nullptr}; // 另一个物体
+        c2d_joint *joint{nullptr}; // 所属关节
+        joint_edge *prev{nullptr}, *next{nullptr};
+    };
+
     // 关节
+    // 每种关节自己实现非虚的prepare()和solve()，求解时由c2d_joint_batch按类型分组调用，
+    // 迭代中没有虚函数调用；冲量用c2d_body::apply_impulse直接作用到速度上
     class c2d_joint {
     public:
-        using ptr = std::unique_ptr<c2d_joint>;
-
-        virtual void prepare(const v2 &gravity) = 0; // 预处理
-        virtual void update(const v2 &gravity) = 0; // 计算
-        virtual void draw() = 0; // 绘制
+        virtual c2d_joint_t type() const = 0; // 类型
+        virtual void draw(c2d_render_batch &batch) = 0; // 绘制
 
-        c2d_joint(c2d_body *_a, c2d_body *_b);
+        c2d_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b);
 
         c2d_joint(const c2d_body &) = delete; // 禁止拷贝
         c2d_joint &operator=(const c2d_joint &) = delete; // 禁止赋值
 
+        void link(); // 挂到两个物体的关节链表上
+        void unlink(); // 从两个物体的关节链表上摘除
+
+        c2d_handle id{0}; // 句柄
+        size_t list_index{0}; // 在世界关节列表中的下标
         c2d_body *a, *b; // 关节涉及的两个物体
+        joint_edge edges[2]; // edges[0]挂在a上，edges[1]挂在b上
     };
 }
 
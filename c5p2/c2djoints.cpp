@@ -0,0 +1,69 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2djoints.h"
+
+namespace clib {
+
+    c2d_joint_batch::c2d_joint_batch(c2d_arena &_arena) : arena(_arena),
+        revolute(arena), distance(arena), weld(arena), prismatic(arena), motor(arena), mouse(arena) {}
+
+    void c2d_joint_batch::reset() {
+        revolute = c2d_arena_vector<c2d_revolute_joint *>(arena);
+        distance = c2d_arena_vector<c2d_distance_joint *>(arena);
+        weld = c2d_arena_vector<c2d_weld_joint *>(arena);
+        prismatic = c2d_arena_vector<c2d_prismatic_joint *>(arena);
+        motor = c2d_arena_vector<c2d_motor_joint *>(arena);
+        mouse = c2d_arena_vector<c2d_mouse_joint *>(arena);
+    }
+
+    void c2d_joint_batch::add(c2d_joint *joint) {
+        switch (joint->type()) {
+            case C2D_JOINT_REVOLUTE:
+                revolute.push_back(static_cast<c2d_revolute_joint *>(joint));
+                break;
+            case C2D_JOINT_DISTANCE:
+                distance.push_back(static_cast<c2d_distance_joint *>(joint));
+                break;
+            case C2D_JOINT_WELD:
+                weld.push_back(static_cast<c2d_weld_joint *>(joint));
+                break;
+            case C2D_JOINT_PRISMATIC:
+                prismatic.push_back(static_cast<c2d_prismatic_joint *>(joint));
+                break;
+            case C2D_JOINT_MOTOR:
+                motor.push_back(static_cast<c2d_motor_joint *>(joint));
+                break;
+            case C2D_JOINT_MOUSE:
+                mouse.push_back(static_cast<c2d_mouse_joint *>(joint));
+                break;
+            default:
+                break;
+        }
+    }
+
+    void c2d_joint_batch::prepare() {
+        for (auto joint : revolute) joint->prepare();
+        for (auto joint : distance) joint->prepare();
+        for (auto joint : weld) joint->prepare();
+        for (auto joint : prismatic) joint->prepare();
+        for (auto joint : motor) joint->prepare();
+        for (auto joint : mouse) joint->prepare();
+    }
+
+    void c2d_joint_batch::solve() {
+        for (auto joint : revolute) joint->solve();
+        for (auto joint : distance) joint->solve();
+        for (auto joint : weld) joint->solve();
+        for (auto joint : prismatic) joint->solve();
+        for (auto joint : motor) joint->solve();
+        for (auto joint : mouse) joint->solve();
+    }
+
+    size_t c2d_joint_batch::size() const {
+        return revolute.size() + distance.size() + weld.size() +
+               prismatic.size() + motor.size() + mouse.size();
+    }
+}
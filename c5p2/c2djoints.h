@@ -0,0 +1,47 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DJOINTS_H
+#define CLIB2D_C2DJOINTS_H
+
+#include "c2darena.h"
+#include "c2drevolute.h"
+#include "c2ddistance.h"
+#include "c2dweld.h"
+#include "c2dprismatic.h"
+#include "c2dmotor.h"
+#include "c2dmouse.h"
+
+namespace clib {
+
+    // 本帧需要计算的关节，按类型分开存放
+    // 加入时判断一次类型，迭代时逐类型调用非虚的prepare()/solve()，同类关节的代码和数据连续
+    class c2d_joint_batch {
+    public:
+        explicit c2d_joint_batch(c2d_arena &arena);
+
+        c2d_joint_batch(const c2d_joint_batch &) = delete; // 禁止拷贝
+        c2d_joint_batch &operator=(const c2d_joint_batch &) = delete; // 禁止赋值
+
+        void reset(); // 清空，内存来自arena，须在arena重置后调用
+        void add(c2d_joint *joint);
+
+        void prepare(); // 预处理
+        void solve(); // 迭代一次
+
+        size_t size() const;
+
+    private:
+        c2d_arena &arena;
+        c2d_arena_vector<c2d_revolute_joint *> revolute;
+        c2d_arena_vector<c2d_distance_joint *> distance;
+        c2d_arena_vector<c2d_weld_joint *> weld;
+        c2d_arena_vector<c2d_prismatic_joint *> prismatic;
+        c2d_arena_vector<c2d_motor_joint *> motor;
+        c2d_arena_vector<c2d_mouse_joint *> mouse;
+    };
+}
+
+#endif //CLIB2D_C2DJOINTS_H
@@ -0,0 +1,72 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2dmotor.h"
+#include "c2dworld.h"
+
+namespace clib {
+
+    c2d_joint_t c2d_motor_joint::type() const {
+        return C2D_JOINT_MOTOR;
+    }
+
+    // 参考Box2D：b2MotorJoint，作用点取两物体的重心
+    void c2d_motor_joint::prepare() {
+        auto &a = *this->a;
+        auto &b = *this->b;
+        auto m = a.inv_mass() + b.inv_mass();
+        auto i = a.inv_inertia() + b.inv_inertia();
+        linear_mass = m > 0 ? 1 / m : 0;
+        angular_mass = i > 0 ? 1 / i : 0;
+        linear_error = b.world() - a.world() - a.rotate(linear_offset);
+        angular_error = b.angle - a.angle - angular_offset;
+
+        // 用上一帧的冲量预热
+        a.apply_impulse(-p, v2());
+        b.apply_impulse(p, v2());
+        a.apply_angular_impulse(-L);
+        b.apply_angular_impulse(L);
+    }
+
+    void c2d_motor_joint::solve() {
+        auto &a = *this->a;
+        auto &b = *this->b;
+        auto k = correction_factor * c2d_world::dt_inv;
+
+        // 角度，累计冲量不超过最大力矩
+        auto max_L = max_torque * c2d_world::dt;
+        auto l = -angular_mass * (b.angleV - a.angleV + k * angular_error);
+        auto old_L = L;
+        L = std::max<decimal>(-max_L, std::min<decimal>(old_L + l, max_L));
+        l = L - old_L;
+        a.apply_angular_impulse(-l);
+        b.apply_angular_impulse(l);
+
+        // 位置，累计冲量不超过最大力
+        auto max_p = max_force * c2d_world::dt;
+        auto P = -linear_mass * (b.V - a.V + k * linear_error);
+        auto old_p = p;
+        p += P;
+        if (p.magnitude_square() > max_p * max_p)
+            p = p.normalize() * max_p;
+        P = p - old_p;
+        a.apply_impulse(-P, v2());
+        b.apply_impulse(P, v2());
+    }
+
+    void c2d_motor_joint::draw(c2d_render_batch &batch) {
+        const c2d_color color{0.8f, 0.4f, 0.9f};
+        auto target = a->world() + a->rotate(linear_offset);
+        batch.line(b->world(), target, color);
+        batch.point(target, color, 4.0f);
+    }
+
+    c2d_motor_joint::c2d_motor_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b,
+                                     decimal _max_force, decimal _max_torque) :
+        c2d_joint(_id, _a, _b), max_force(_max_force), max_torque(_max_torque) {
+        linear_offset = a->rotate_inv(b->world() - a->world());
+        angular_offset = b->angle - a->angle;
+    }
+}
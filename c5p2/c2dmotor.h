@@ -0,0 +1,44 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DMOTOR_H
+#define CLIB2D_C2DMOTOR_H
+
+#include "c2djoint.h"
+
+namespace clib {
+    // 马达关节：以有限的力和力矩把物体B驱动到物体A上的目标位置和角度
+    class c2d_motor_joint final : public c2d_joint {
+    public:
+        c2d_joint_t type() const override;
+
+        void prepare(); // 预处理
+
+        void solve(); // 计算
+
+        void draw(c2d_render_batch &batch) override;
+
+        // 目标为当前的相对位置和角度
+        c2d_motor_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b, decimal max_force, decimal max_torque);
+
+        c2d_motor_joint(const c2d_motor_joint &) = delete; // 禁止拷贝
+        c2d_motor_joint &operator=(const c2d_motor_joint &) = delete; // 禁止赋值
+
+        v2 linear_offset; // 目标位置（物体A的本地坐标）
+        decimal angular_offset{0}; // 目标角度
+        decimal max_force{0}; // 最大力
+        decimal max_torque{0}; // 最大力矩
+        decimal correction_factor{0.3}; // 位置修正系数
+
+        decimal linear_mass{0}; // 有效质量
+        decimal angular_mass{0}; // 有效转动惯量
+        v2 linear_error; // 位置偏差
+        decimal angular_error{0}; // 角度偏差
+        v2 p; // 冲量累计
+        decimal L{0}; // 角冲量累计
+    };
+}
+
+#endif //CLIB2D_C2DMOTOR_H
@@ -0,0 +1,74 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2dmouse.h"
+#include "c2dworld.h"
+
+namespace clib {
+
+    c2d_joint_t c2d_mouse_joint::type() const {
+        return C2D_JOINT_MOUSE;
+    }
+
+    // 参考Box2D：b2MouseJoint，弹簧阻尼换算成软约束
+    void c2d_mouse_joint::prepare() {
+        auto &b = *this->b;
+        r = b.rotate(local_anchor);
+        auto mB = b.inv_mass(), iB = b.inv_inertia();
+        auto m = mB > 0 ? 1 / mB : 0;
+        auto omega = PI2 * frequency;
+        auto d = 2 * m * damping_ratio * omega; // 阻尼系数
+        auto k = m * omega * omega; // 弹簧系数
+        auto h = c2d_world::dt;
+        gamma = h * (d + h * k);
+        gamma = gamma != 0 ? 1 / gamma : 0;
+        auto beta = h * k * gamma;
+
+        auto K = m2(mB + gamma) +
+                 (iB * m2(r.y * r.y, -r.y * r.x, -r.y * r.x, r.x * r.x));
+        mass = K.inv();
+        C = beta * (b.world() + r - target);
+        b.angleV *= 0.98; // 拖动时稍微抑制转动
+
+        // 用上一帧的冲量预热
+        b.apply_impulse(p, r);
+    }
+
+    void c2d_mouse_joint::solve() {
+        auto &b = *this->b;
+        auto dv = b.V + (-b.angleV * r.N());
+        auto P = mass * (-(dv + C + gamma * p));
+        auto old_p = p;
+        p += P;
+        auto max_p = max_force * c2d_world::dt;
+        if (p.magnitude_square() > max_p * max_p)
+            p = p.normalize() * max_p;
+        P = p - old_p;
+        b.apply_impulse(P, r);
+    }
+
+    void c2d_mouse_joint::draw(c2d_render_batch &batch) {
+        const c2d_color color{0.9f, 0.7f, 0.4f};
+        batch.line(world_anchor(), target, {0.6f, 0.6f, 0.6f});
+        batch.point(world_anchor(), color, 4.0f);
+        batch.point(target, color, 4.0f);
+    }
+
+    v2 c2d_mouse_joint::world_anchor() const {
+        return b->rotate(local_anchor) + b->world();
+    }
+
+    void c2d_mouse_joint::set_target(const v2 &_target) {
+        target = _target;
+#if ENABLE_SLEEP
+        b->wake();
+#endif
+    }
+
+    c2d_mouse_joint::c2d_mouse_joint(c2d_handle _id, c2d_body *body, const v2 &anchor, decimal _max_force) :
+        c2d_joint(_id, body, body), target(anchor), max_force(_max_force) {
+        local_anchor = b->rotate_inv(anchor - b->world());
+    }
+}
@@ -0,0 +1,48 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DMOUSE_H
+#define CLIB2D_C2DMOUSE_H
+
+#include "c2djoint.h"
+#include "m2.h"
+
+namespace clib {
+    // 鼠标关节：用软约束把物体上的一点拉向目标点，a和b是同一个物体
+    class c2d_mouse_joint final : public c2d_joint {
+    public:
+        c2d_joint_t type() const override;
+
+        void prepare(); // 预处理
+
+        void solve(); // 计算
+
+        void draw(c2d_render_batch &batch) override;
+
+        v2 world_anchor() const;
+
+        void set_target(const v2 &target); // 移动目标点
+
+        // 锚点为物体上被抓住的点（世界坐标），起初与目标点重合
+        c2d_mouse_joint(c2d_handle _id, c2d_body *body, const v2 &anchor, decimal max_force);
+
+        c2d_mouse_joint(const c2d_mouse_joint &) = delete; // 禁止拷贝
+        c2d_mouse_joint &operator=(const c2d_mouse_joint &) = delete; // 禁止赋值
+
+        v2 local_anchor; // 锚点（本地坐标）
+        v2 target; // 目标点
+        decimal max_force{0}; // 最大力
+        decimal frequency{5}; // 弹簧频率
+        decimal damping_ratio{0.7}; // 阻尼比
+
+        v2 r; // 重心到锚点
+        m2 mass; // 质量矩阵
+        v2 C; // 位置补偿
+        decimal gamma{0}; // 软约束系数
+        v2 p; // 冲量累计
+    };
+}
+
+#endif //CLIB2D_C2DMOUSE_H
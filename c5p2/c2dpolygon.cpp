@@ -8,7 +8,7 @@
 
 namespace clib {
 
-    c2d_polygon::c2d_polygon(uint16_t _id, decimal _mass, const std::vector<v2> &_vertices)
+    c2d_polygon::c2d_polygon(c2d_handle _id, decimal _mass, const std::vector<v2> &_vertices)
         : c2d_body(_id, _mass), vertices(_vertices), verticesWorld(_vertices) {
         init();
     }
@@ -53,17 +53,21 @@ namespace clib {
         return mass * acc0 / 6 / acc1;
     }
 
-    void c2d_polygon::calc_bounds() {
-        boundMin = boundMax = vertex(0);
-        for (size_t i = 1; i < verticesWorld.size(); ++i) {
-            boundMin.x = std::min(boundMin.x, vertex(i).x);
-            boundMin.y = std::min(boundMin.y, vertex(i).y);
-            boundMax.x = std::max(boundMax.x, vertex(i).x);
-            boundMax.y = std::max(boundMax.y, vertex(i).y);
+    void c2d_polygon::calc_box() {
+        auto lo = vertices[0] - center, hi = lo;
+        for (size_t i = 1; i < vertices.size(); ++i) {
+            auto v = vertices[i] - center;
+            lo.x = std::min(lo.x, v.x);
+            lo.y = std::min(lo.y, v.y);
+            hi.x = std::max(hi.x, v.x);
+            hi.y = std::max(hi.y, v.y);
         }
+        box_center = (lo + hi) / 2;
+        box_half = (hi - lo) / 2;
     }
 
     bool c2d_polygon::contains_in_bound(const v2 &pt) {
+        const auto boundMin = min(), boundMax = max();
         return boundMin.x < pt.x &&
                boundMax.x > pt.x &&
                boundMin.y < pt.y &&
@@ -102,16 +106,20 @@ namespace clib {
     void c2d_polygon::init() {
         inertia.set(calc_polygon_inertia(mass.value, vertices));
         center = calc_polygon_centroid(vertices);
+        calc_box();
         refresh();
     }
 
     void c2d_polygon::refresh() {
-        R.rotate(angle);
-        for (size_t i = 0; i < edges(); ++i) {
-            auto v = R.rotate(vertices[i] - center) + center;
-            vertex(i) = pos + v; // 本地坐标转换为世界坐标
+        sync_vertices();
+    }
+
+    void c2d_polygon::sync_vertices() const {
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            auto v = rotate(vertices[i] - center) + center;
+            verticesWorld[i] = pos + v; // 本地坐标转换为世界坐标
         }
-        calc_bounds();
+        dirty = false;
     }
 
     void c2d_polygon::impulse(const v2 &p, const v2 &r) {
@@ -130,12 +138,47 @@ namespace clib {
         return C2D_POLYGON;
     }
 
+    // 包围盒由旋转后的本地包围盒得出，不需要变换顶点（矩形时与顶点边界一致）
     v2 c2d_polygon::min() const {
-        return boundMin;
+        const auto half = v2(std::abs(rot.x) * box_half.x + std::abs(rot.y) * box_half.y,
+                             std::abs(rot.y) * box_half.x + std::abs(rot.x) * box_half.y);
+        return pos + center + rotate(box_center) - half;
     }
 
     v2 c2d_polygon::max() const {
-        return boundMax;
+        const auto half = v2(std::abs(rot.x) * box_half.x + std::abs(rot.y) * box_half.y,
+                             std::abs(rot.y) * box_half.x + std::abs(rot.x) * box_half.y);
+        return pos + center + rotate(box_center) + half;
+    }
+
+    // 参考Box2D：https://github.com/erincatto/Box2D/blob/master/Box2D/Collision/Shapes/b2PolygonShape.cpp#L300
+    bool c2d_polygon::raycast(const c2d_ray &ray, c2d_raycast_hit &hit) {
+        decimal lower = 0, upper = ray.max_t;
+        auto index = SIZE_MAX;
+        // 依次用每条边所在的半平面裁剪射线
+        for (size_t i = 0; i < edges(); ++i) {
+            auto N = edge(i).normal(); // 逆时针排列，N指向多边形外侧
+            auto numerator = N.dot(vertex(i) - ray.origin);
+            auto denominator = N.dot(ray.dir);
+            if (denominator == 0) {
+                if (numerator < 0)
+                    return false; // 平行且在外侧
+            } else if (denominator < 0 && numerator < lower * denominator) {
+                lower = numerator / denominator; // 射入
+                index = i;
+            } else if (denominator > 0 && numerator < upper * denominator) {
+                upper = numerator / denominator; // 射出
+            }
+            if (upper < lower)
+                return false;
+        }
+        if (index == SIZE_MAX)
+            return false; // 起点在多边形内
+        hit.body = this;
+        hit.t = lower;
+        hit.point = ray.origin + ray.dir * lower;
+        hit.normal = edge(index).normal();
+        return true;
     }
 
     void c2d_polygon::update(v2 gravity, int n) {
@@ -179,13 +222,8 @@ namespace clib {
 
     void c2d_polygon::pass2() {
         pos += V * c2d_world::dt;
-        angle += angleV * c2d_world::dt;
-        R.rotate(angle);
-        for (size_t i = 0; i < edges(); ++i) {
-            auto v = R.rotate(vertices[i] - center) + center;
-            vertex(i) = pos + v; // 本地坐标转换为世界坐标
-        }
-        calc_bounds();
+        integrate_angle(angleV * c2d_world::dt);
+        dirty = true; // 顶点等用到时再变换
     }
 
     void c2d_polygon::pass3(const v2 &gravity) {
@@ -199,15 +237,11 @@ namespace clib {
 
     void c2d_polygon::pass5() {
 #if ENABLE_SLEEP
-        // 当合外力和速度为零时，判定休眠
-        if (Fa.zero(EPSILON_FORCE) && V.zero(EPSILON_V) && std::abs(angleV) < EPSILON_ANGLE_V) {
-            V.x = 0;
-            V.y = 0;
-            angleV = 0;
-            pass0();
-            pass4();
-            collision = 0;
-            sleep = true;
+        // 当速度和角速度足够小时，判定静止
+        if (V.zero(SLEEP_V) && std::abs(angleV) < SLEEP_ANGLE_V) {
+            sleep_time += c2d_world::dt; // 累计静止时间，由所在岛屿统一判定休眠
+        } else {
+            sleep_time = 0;
         }
 #endif
     }
@@ -217,89 +251,34 @@ namespace clib {
         angleV += inertia.inv * (pt - pos - center).cross(offset);
     }
 
-    void c2d_polygon::draw() {
+    void c2d_polygon::draw(c2d_render_batch &batch) {
+        sync();
         if (statics) { // 画静态物体
-            glColor3f(0.9f, 0.9f, 0.9f);
-            glBegin(GL_LINE_LOOP);
-            for (auto &v : verticesWorld) {
-                glVertex2d(v.x, v.y);
-            }
-            glEnd();
+            batch.loop(verticesWorld.data(), verticesWorld.size(), {0.9f, 0.9f, 0.9f});
             return;
         }
 #if ENABLE_SLEEP
         if (sleep) { // 画休眠物体
-            glColor3f(0.3f, 0.3f, 0.3f);
-            glBegin(GL_LINE_LOOP);
-            for (auto &v : verticesWorld) {
-                glVertex2d(v.x, v.y);
-            }
-            glEnd();
-            glColor3f(0.0f, 1.0f, 0.0f);
-            glPointSize(1.0f);
-            glBegin(GL_POINTS);
-            auto p = pos + center;
-            glVertex2d(p.x, p.y); // 中心
-            glEnd();
+            batch.loop(verticesWorld.data(), verticesWorld.size(), {0.3f, 0.3f, 0.3f});
+            batch.point(pos + center, {0.0f, 1.0f, 0.0f}); // 中心
             return;
         }
 #endif
-        // 开启反走样
-        glEnable(GL_BLEND);
-        glEnable(GL_LINE_SMOOTH);
-        glHint(GL_LINE_SMOOTH_HINT, GL_FASTEST);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glColor3f(0.12f, 0.12f, 0.12f); // 坑：所有设置要放begin之前，切记！
-        glBegin(GL_LINE_LOOP);
-        glVertex2d(boundMin.x, boundMin.y);
-        glVertex2d(boundMin.x, boundMax.y);
-        glVertex2d(boundMax.x, boundMax.y);
-        glVertex2d(boundMax.x, boundMin.y);
-        glEnd();
-        if (collision > 0)
-            glColor3f(0.8f, 0.2f, 0.4f);
-        else
-            glColor3f(0.8f, 0.8f, 0.0f);
-        glBegin(GL_LINE_LOOP);
-        for (auto &v : verticesWorld) {
-            glVertex2d(v.x, v.y);
-        }
-        glEnd();
+        batch.rect(min(), max(), {0.12f, 0.12f, 0.12f});
+        batch.loop(verticesWorld.data(), verticesWorld.size(),
+                   collision > 0 ? c2d_color{0.8f, 0.2f, 0.4f} : c2d_color{0.8f, 0.8f, 0.0f});
         // 这里默认物体是中心对称的，重心就是中心，后面会计算重心
         auto p = pos + center;
-        auto v = p + V * 0.2;
-        glLineWidth(0.6f);
-        glColor3f(0.8f, 0.2f, 0.2f);
-        glBegin(GL_LINES);
-        glVertex2d(p.x, p.y);
-        glVertex2d(p.x + (Fa.x >= 0 ? 0.2 : -0.2) * std::log10(1 + std::abs(Fa.x) * 5),
-                   p.y + (Fa.y >= 0 ? 0.2 : -0.2) * std::log10(1 + std::abs(Fa.y) * 5)); // 力向量
-        glEnd();
-        glColor3f(0.0f, 1.0f, 0.0f);
-        glBegin(GL_LINES);
-        glVertex2d(p.x, p.y);
-        glVertex2d(v.x, v.y); // 速度向量
-        glEnd();
-        glColor3f(0.2f, 0.2f, 0.2f);
-        glBegin(GL_LINES);
-        glVertex2d(p.x, p.y);
-        glVertex2d(p.x + R.x1 * 0.2, p.y + R.x2 * 0.2); // 方向向量
-        glEnd();
-        glColor3f(0.0f, 1.0f, 0.0f);
-        glPointSize(3.0f);
-        glBegin(GL_POINTS);
-        glVertex2d(p.x, p.y); // 中心
-        glEnd();
-        glDisable(GL_BLEND);
-        glDisable(GL_LINE_SMOOTH);
-        glLineWidth(1.0f);
+        draw_vectors(batch, p, rot);
     }
 
     v2 c2d_polygon::edge(size_t idx) const {
+        sync();
         return verticesWorld[index(idx + 1)] - verticesWorld[index(idx)];
     }
 
     v2 &c2d_polygon::vertex(size_t idx) {
+        sync();
         return verticesWorld[index(idx)];
     }
 
@@ -7,16 +7,13 @@
 #define CLIB2D_C2DPOLYGON_H
 
 #include <vector>
-#include <GL/freeglut.h>
 #include "c2dbody.h"
 
 namespace clib {
     // 多边形刚体（仅支持凸多边形，且点集为有序排列）
     class c2d_polygon : public c2d_body {
     public:
-        using ptr = std::unique_ptr<c2d_polygon>;
-
-        c2d_polygon(uint16_t _id, decimal _mass, const std::vector<v2> &_vertices);
+        c2d_polygon(c2d_handle _id, decimal _mass, const std::vector<v2> &_vertices);
 
         // 计算多边形面积
         static decimal calc_polygon_area(const std::vector<v2> &vertices);
@@ -27,8 +24,8 @@ namespace clib {
         // 计算多边形转动惯量
         static decimal calc_polygon_inertia(decimal mass, const std::vector<v2> &vertices);
 
-        // 计算边界（矩形包围）
-        void calc_bounds();
+        // 计算本地包围盒（相对重心）
+        void calc_box();
 
         // 判断在边界内
         bool contains_in_bound(const v2 &pt);
@@ -52,6 +49,8 @@ namespace clib {
 
         v2 max() const override;
 
+        bool raycast(const c2d_ray &ray, c2d_raycast_hit &hit) override;
+
         void update(v2 gravity, int n) override;
 
         void pass0();
@@ -69,7 +68,7 @@ namespace clib {
         // 拖拽物体
         void drag(const v2 &pt, const v2 &offset) override;
 
-        void draw() override;
+        void draw(c2d_render_batch &batch) override;
 
         // 以idx为起点，下一顶点为终点的向量
         v2 edge(size_t idx) const override;
@@ -80,11 +79,12 @@ namespace clib {
 
         size_t edges() const override;
 
+        void sync_vertices() const override;
+
         v2 center; // 重心
-        m2 R; // 旋转矩阵
         std::vector<v2> vertices; // 多边形的顶点（本地坐标）
-        std::vector<v2> verticesWorld; // 多边形的顶点（世界坐标）
-        v2 boundMin, boundMax; // 外包矩形
+        mutable std::vector<v2> verticesWorld; // 多边形的顶点（世界坐标，按需计算）
+        v2 box_center, box_half; // 本地包围盒的中心（相对重心）和半边长
     };
 }
 
@@ -0,0 +1,143 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DPOOL_H
+#define CLIB2D_C2DPOOL_H
+
+#include <stdexcept>
+#include <vector>
+#include "c2d.h"
+#include "c2darena.h"
+
+namespace clib {
+
+    // 对象池（物体、关节），用句柄引用对象
+    // 句柄 = 版本号 << HANDLE_INDEX_BITS | 槽位下标，各32位
+    // 对象销毁后槽位的版本号加一，旧句柄随即失效，槽位和内存都可以O(1)复用
+    // 版本号用完的槽位不再复用（不回绕），旧句柄永远不会误指向新对象
+    // 对象内存由定长结点池分配，不会移动，所以对象指针在销毁前一直有效
+    template<class T>
+    class c2d_object_pool {
+    public:
+        c2d_object_pool() = default;
+        ~c2d_object_pool() { clear(); }
+
+        c2d_object_pool(const c2d_object_pool &) = delete; // 禁止拷贝
+        c2d_object_pool &operator=(const c2d_object_pool &) = delete; // 禁止赋值
+
+        static uint32_t index(c2d_handle h) { return (uint32_t) (h & HANDLE_INDEX_MASK); }
+        static uint32_t generation(c2d_handle h) { return (uint32_t) (h >> HANDLE_INDEX_BITS); }
+
+        // 创建对象，构造函数的第一个参数为句柄
+        template<class U, class ... Args>
+        U *make(Args &&... args) {
+            uint32_t idx;
+            if (free_head != null_slot) {
+                idx = free_head;
+                free_head = slots[idx].next_free;
+            } else {
+                if (slots.size() >= null_slot)
+                    throw std::length_error("c2d_object_pool: too many objects");
+                idx = (uint32_t) slots.size();
+                slots.emplace_back();
+            }
+            auto &s = slots[idx];
+            auto h = (c2d_handle) s.generation << HANDLE_INDEX_BITS | idx;
+            auto mem = c2d_pool_allocator<U>().allocate(1);
+            auto obj = new(mem) U(h, std::forward<Args>(args)...);
+            s.obj = obj;
+            s.release = &release_impl<U>;
+            ++count;
+            return obj;
+        }
+
+        // 销毁对象，句柄失效返回false
+        bool destroy(c2d_handle h) {
+            auto obj = get(h);
+            if (!obj)
+                return false;
+            auto idx = index(h);
+            auto &s = slots[idx];
+            s.release(obj);
+            s.obj = nullptr;
+            s.release = nullptr;
+            if (next_generation(s)) {
+                s.next_free = free_head;
+                free_head = idx;
+            }
+            --count;
+            return true;
+        }
+
+        // 根据句柄取对象，句柄失效时返回nullptr
+        T *get(c2d_handle h) const {
+            auto idx = index(h);
+            if (idx >= slots.size())
+                return nullptr;
+            const auto &s = slots[idx];
+            if (!s.obj || s.generation != generation(h))
+                return nullptr;
+            return s.obj;
+        }
+
+        size_t size() const { return count; }
+
+        // 预留n个新对象的槽位，批量创建时避免反复扩容
+        void reserve(size_t n) {
+            if (count + n > slots.size())
+                slots.reserve(count + n);
+        }
+
+        // 销毁所有对象，槽位保留（版本号照常递增），旧句柄不会误指向新对象
+        void clear() {
+            free_head = null_slot;
+            for (auto i = (uint32_t) slots.size(); i-- > 0;) {
+                auto &s = slots[i];
+                if (s.obj) {
+                    s.release(s.obj);
+                    s.obj = nullptr;
+                    s.release = nullptr;
+                    next_generation(s);
+                }
+                if (s.generation == retired)
+                    continue;
+                s.next_free = free_head;
+                free_head = i;
+            }
+            count = 0;
+        }
+
+    private:
+        static const uint32_t null_slot = UINT32_MAX;
+        static const uint32_t retired = UINT32_MAX; // 版本号用完，槽位作废
+
+        struct slot {
+            T *obj{nullptr};
+            void (*release)(T *){nullptr}; // 按实际类型析构并归还内存
+            uint32_t generation{1}; // 从1开始，句柄0保留为空句柄
+            uint32_t next_free{null_slot};
+        };
+
+        // 返回槽位是否还能复用
+        static bool next_generation(slot &s) {
+            if (s.generation != retired)
+                s.generation++;
+            return s.generation != retired;
+        }
+
+        template<class U>
+        static void release_impl(T *t) {
+            auto u = static_cast<U *>(t);
+            u->~U();
+            c2d_pool_allocator<U>().deallocate(u, 1);
+        }
+
+        std::vector<slot> slots;
+        uint32_t free_head{null_slot};
+        size_t count{0};
+    };
+}
+
+#endif //CLIB2D_C2DPOOL_H
@@ -0,0 +1,131 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2dprismatic.h"
+#include "c2dworld.h"
+
+namespace clib {
+
+    static const auto kBiasFactor = 0.2;
+
+    c2d_joint_t c2d_prismatic_joint::type() const {
+        return C2D_JOINT_PRISMATIC;
+    }
+
+    void c2d_prismatic_joint::prepare() {
+        auto &a = *this->a;
+        auto &b = *this->b;
+        ra = a.rotate(local_anchor_a);
+        rb = b.rotate(local_anchor_b);
+        d = b.world() + rb - a.world() - ra;
+        axis = a.rotate(local_axis);
+        perp = axis.N();
+        translation = axis.dot(d);
+        auto mA = a.inv_mass(), mB = b.inv_mass();
+        auto iA = a.inv_inertia(), iB = b.inv_inertia();
+
+        // 法向约束：B锚点不能离开轴
+        auto s1 = (d + ra).cross(perp), s2 = rb.cross(perp);
+        auto k = mA + mB + iA * s1 * s1 + iB * s2 * s2;
+        perp_mass = k > 0 ? 1 / k : 0;
+        perp_bias = kBiasFactor * c2d_world::dt_inv * perp.dot(d);
+
+        // 轴向（限位）
+        auto a1 = (d + ra).cross(axis), a2 = rb.cross(axis);
+        k = mA + mB + iA * a1 * a1 + iB * a2 * a2;
+        axial_mass = k > 0 ? 1 / k : 0;
+
+        // 角度约束
+        angular_mass = iA + iB > 0 ? 1 / (iA + iB) : 0;
+        angular_bias = kBiasFactor * c2d_world::dt_inv * (b.angle - a.angle - reference_angle);
+
+        if (!enable_limit)
+            lower_p = upper_p = 0;
+
+        // 用上一帧的冲量预热
+        auto P = p * perp + (lower_p - upper_p) * axis;
+        a.apply_impulse(-P, d + ra);
+        b.apply_impulse(P, rb);
+        a.apply_angular_impulse(-L);
+        b.apply_angular_impulse(L);
+    }
+
+    void c2d_prismatic_joint::solve() {
+        auto &a = *this->a;
+        auto &b = *this->b;
+
+        // 限位，越界前按剩余距离限速，越界后按偏差补偿
+        if (enable_limit) {
+            auto limit = [&](decimal C, decimal sign, decimal &acc) {
+                auto dv = (b.V + (-b.angleV * rb.N())) -
+                          (a.V + (-a.angleV * (d + ra).N()));
+                auto bias = C > 0 ? C * c2d_world::dt_inv : kBiasFactor * c2d_world::dt_inv * C;
+                auto impulse = -axial_mass * (sign * axis.dot(dv) + bias);
+                auto old = acc;
+                acc = std::max<decimal>(old + impulse, 0);
+                auto P = (acc - old) * sign * axis;
+                a.apply_impulse(-P, d + ra);
+                b.apply_impulse(P, rb);
+            };
+            limit(translation - lower, 1, lower_p);
+            limit(upper - translation, -1, upper_p);
+        }
+
+        // 角度约束
+        auto l = -angular_mass * (b.angleV - a.angleV + angular_bias);
+        L += l;
+        a.apply_angular_impulse(-l);
+        b.apply_angular_impulse(l);
+
+        // 法向约束
+        auto dv = (b.V + (-b.angleV * rb.N())) -
+                  (a.V + (-a.angleV * (d + ra).N()));
+        auto lambda = -perp_mass * (perp.dot(dv) + perp_bias);
+        p += lambda;
+        auto P = lambda * perp;
+        a.apply_impulse(-P, d + ra);
+        b.apply_impulse(P, rb);
+    }
+
+    void c2d_prismatic_joint::draw(c2d_render_batch &batch) {
+        const c2d_color color{0.3f, 0.8f, 0.5f};
+        auto anchor = world_anchor_a();
+        auto dir = world_axis();
+        if (enable_limit) {
+            batch.line(anchor + lower * dir, anchor + upper * dir, color);
+            batch.point(anchor + lower * dir, color, 4.0f);
+            batch.point(anchor + upper * dir, color, 4.0f);
+        } else {
+            batch.line(anchor - dir, anchor + dir, color);
+        }
+        batch.line(anchor, world_anchor_b(), {0.6f, 0.6f, 0.6f});
+    }
+
+    v2 c2d_prismatic_joint::world_anchor_a() const {
+        return a->rotate(local_anchor_a) + a->world();
+    }
+
+    v2 c2d_prismatic_joint::world_anchor_b() const {
+        return b->rotate(local_anchor_b) + b->world();
+    }
+
+    v2 c2d_prismatic_joint::world_axis() const {
+        return a->rotate(local_axis);
+    }
+
+    void c2d_prismatic_joint::set_limit(decimal _lower, decimal _upper) {
+        enable_limit = true;
+        lower = std::min(_lower, _upper);
+        upper = std::max(_lower, _upper);
+    }
+
+    c2d_prismatic_joint::c2d_prismatic_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b,
+                                             const v2 &anchor, const v2 &_axis) :
+        c2d_joint(_id, _a, _b), reference_angle(_b->angle - _a->angle) {
+        local_anchor_a = a->rotate_inv(anchor - a->world());
+        local_anchor_b = b->rotate_inv(anchor - b->world());
+        local_axis = a->rotate_inv(_axis.normalize());
+    }
+}
@@ -0,0 +1,57 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DPRISMATIC_H
+#define CLIB2D_C2DPRISMATIC_H
+
+#include "c2djoint.h"
+
+namespace clib {
+    // 滑动关节：物体B只能沿物体A上的轴平移，不能相对转动
+    class c2d_prismatic_joint final : public c2d_joint {
+    public:
+        c2d_joint_t type() const override;
+
+        void prepare(); // 预处理
+
+        void solve(); // 计算
+
+        void draw(c2d_render_batch &batch) override;
+
+        v2 world_anchor_a() const;
+
+        v2 world_anchor_b() const;
+
+        v2 world_axis() const;
+
+        void set_limit(decimal lower, decimal upper); // 限制平移范围
+
+        // 锚点和轴为世界坐标
+        c2d_prismatic_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b, const v2 &anchor, const v2 &axis);
+
+        c2d_prismatic_joint(const c2d_prismatic_joint &) = delete; // 禁止拷贝
+        c2d_prismatic_joint &operator=(const c2d_prismatic_joint &) = delete; // 禁止赋值
+
+        v2 local_anchor_a; // 物体A的锚点（本地坐标）
+        v2 local_anchor_b; // 物体B的锚点（本地坐标）
+        v2 local_axis; // 滑动轴（物体A的本地坐标）
+        decimal reference_angle{0}; // 创建时的相对角度
+        bool enable_limit{false}; // 是否限制平移
+        decimal lower{0}, upper{0}; // 平移范围
+
+        v2 ra; // 物体A重心到锚点
+        v2 rb; // 物体B重心到锚点
+        v2 d; // A锚点指向B锚点
+        v2 axis, perp; // 滑动轴及其法线
+        decimal translation{0}; // 当前平移量
+        decimal perp_mass{0}, axial_mass{0}, angular_mass{0}; // 有效质量
+        decimal perp_bias{0}, angular_bias{0}; // 位置补偿
+        decimal p{0}; // 法向冲量累计
+        decimal L{0}; // 角冲量累计
+        decimal lower_p{0}, upper_p{0}; // 限位冲量累计
+    };
+}
+
+#endif //CLIB2D_C2DPRISMATIC_H
@@ -0,0 +1,87 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DQUEUE_H
+#define CLIB2D_C2DQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace clib {
+
+    // 无锁多生产者单消费者队列
+    // 参考Vyukov的非侵入式MPSC队列：http://www.1024cores.net/home/lock-free-algorithms/queues/non-intrusive-mpsc-node-based-queue
+    // 生产者只做一次原子交换，不会等待；消费者只有一个（模拟线程）
+    template<class T>
+    class c2d_mpsc_queue {
+    public:
+        c2d_mpsc_queue() : head(&stub), tail(&stub) {}
+
+        ~c2d_mpsc_queue() {
+            T t;
+            while (pop(t));
+        }
+
+        c2d_mpsc_queue(const c2d_mpsc_queue &) = delete; // 禁止拷贝
+        c2d_mpsc_queue &operator=(const c2d_mpsc_queue &) = delete; // 禁止赋值
+
+        // 任意线程调用
+        void push(T value) {
+            auto n = new node;
+            n->value = std::move(value);
+            push_node(n);
+        }
+
+        // 只能由消费者调用，队列为空（或生产者正在入队）时返回false
+        bool pop(T &out) {
+            auto t = tail;
+            auto next = t->next.load(std::memory_order_acquire);
+            if (t == &stub) { // 跳过哨兵
+                if (!next)
+                    return false;
+                tail = next;
+                t = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                tail = next;
+                out = std::move(t->value);
+                delete t;
+                return true;
+            }
+            if (t != head.load(std::memory_order_acquire))
+                return false; // 生产者还没链接完，下次再取
+            // t是最后一个结点，放回哨兵后才能取走t
+            stub.next.store(nullptr, std::memory_order_relaxed);
+            push_node(&stub);
+            next = t->next.load(std::memory_order_acquire);
+            if (next) {
+                tail = next;
+                out = std::move(t->value);
+                delete t;
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        struct node {
+            std::atomic<node *> next{nullptr};
+            T value;
+        };
+
+        void push_node(node *n) {
+            n->next.store(nullptr, std::memory_order_relaxed);
+            auto prev = head.exchange(n, std::memory_order_acq_rel);
+            prev->next.store(n, std::memory_order_release);
+        }
+
+        node stub; // 哨兵
+        std::atomic<node *> head; // 生产者入队的位置
+        node *tail; // 消费者出队的位置
+    };
+}
+
+#endif //CLIB2D_C2DQUEUE_H
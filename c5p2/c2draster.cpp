@@ -0,0 +1,263 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include <fstream>
+#include <algorithm>
+#include "c2draster.h"
+
+namespace clib {
+
+    c2d_raster::c2d_raster(int width, int height) : w(width), h(height), pixels((size_t) width * height * 4) {
+        set_view(v2(), 10 * std::tan(M_PI / 8));
+        clear();
+    }
+
+    void c2d_raster::set_view(const v2 &center, decimal half_height) {
+        view_center = center;
+        view_scale = h / (2 * half_height);
+    }
+
+    void c2d_raster::clear(const c2d_color &c) {
+        uint8_t rgba[4] = {
+            (uint8_t) (c.r * 255), (uint8_t) (c.g * 255), (uint8_t) (c.b * 255), (uint8_t) (c.a * 255)
+        };
+        for (size_t i = 0; i < pixels.size(); i += 4)
+            std::copy(rgba, rgba + 4, &pixels[i]);
+    }
+
+    void c2d_raster::to_screen(float x, float y, float &sx, float &sy) const {
+        sx = (float) ((x - view_center.x) * view_scale + w * 0.5);
+        sy = (float) (h * 0.5 - (y - view_center.y) * view_scale); // 屏幕y轴向下
+    }
+
+    // 与OpenGL的GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA混合一致
+    void c2d_raster::plot(int x, int y, const c2d_color &c) {
+        if (x < 0 || y < 0 || x >= w || y >= h)
+            return;
+        auto p = &pixels[((size_t) y * w + x) * 4];
+        auto a = c.a;
+        p[0] = (uint8_t) (c.r * 255 * a + p[0] * (1 - a));
+        p[1] = (uint8_t) (c.g * 255 * a + p[1] * (1 - a));
+        p[2] = (uint8_t) (c.b * 255 * a + p[2] * (1 - a));
+        p[3] = 255;
+    }
+
+    void c2d_raster::fill(int x, int y, int size, const c2d_color &c) {
+        if (size <= 1) {
+            plot(x, y, c);
+            return;
+        }
+        auto x0 = x - size / 2, y0 = y - size / 2;
+        for (auto j = y0; j < y0 + size; ++j)
+            for (auto i = x0; i < x0 + size; ++i)
+                plot(i, j, c);
+    }
+
+    // DDA画线，先按Liang-Barsky算法裁剪到画面内，避免画面外的长线段
+    void c2d_raster::draw_line(float x0, float y0, float x1, float y1, const c2d_color &c, int size) {
+        auto dx = x1 - x0, dy = y1 - y0;
+        float t0 = 0, t1 = 1;
+        auto clip = [&](float p, float q) {
+            if (p == 0)
+                return q >= 0;
+            auto r = q / p;
+            if (p < 0) {
+                if (r > t1) return false;
+                t0 = std::max(t0, r);
+            } else {
+                if (r < t0) return false;
+                t1 = std::min(t1, r);
+            }
+            return true;
+        };
+        const float margin = (float) size;
+        if (!clip(-dx, x0 + margin) || !clip(dx, w + margin - x0) ||
+            !clip(-dy, y0 + margin) || !clip(dy, h + margin - y0))
+            return;
+        auto sx = x0 + t0 * dx, sy = y0 + t0 * dy;
+        auto ex = x0 + t1 * dx, ey = y0 + t1 * dy;
+        auto steps = (int) std::ceil(std::max(std::abs(ex - sx), std::abs(ey - sy)));
+        if (steps == 0) {
+            fill((int) std::floor(sx), (int) std::floor(sy), size, c);
+            return;
+        }
+        auto ix = (ex - sx) / steps, iy = (ey - sy) / steps;
+        // 线段端点不重复绘制，与GL_LINES的半开区间规则一致
+        for (auto i = 0; i < steps; ++i) {
+            fill((int) std::floor(sx + ix * i), (int) std::floor(sy + iy * i), size, c);
+        }
+    }
+
+    void c2d_raster::render(const c2d_render_batch &batch) {
+        for (auto &g : batch.lines()) {
+            auto size = std::max(1, (int) std::lround(g.size));
+            auto &vs = g.vertices;
+            for (size_t i = 0; i + 1 < vs.size(); i += 2) {
+                float x0, y0, x1, y1;
+                to_screen(vs[i].x, vs[i].y, x0, y0);
+                to_screen(vs[i + 1].x, vs[i + 1].y, x1, y1);
+                draw_line(x0, y0, x1, y1, {vs[i].r, vs[i].g, vs[i].b, vs[i].a}, size);
+            }
+        }
+        for (auto &g : batch.points()) {
+            auto size = std::max(1, (int) std::lround(g.size));
+            for (auto &v : g.vertices) {
+                float x, y;
+                to_screen(v.x, v.y, x, y);
+                fill((int) std::floor(x), (int) std::floor(y), size, {v.r, v.g, v.b, v.a});
+            }
+        }
+    }
+
+    bool c2d_raster::write_ppm(const std::string &filename) const {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs)
+            return false;
+        ofs << "P6\n" << w << " " << h << "\n255\n";
+        std::vector<uint8_t> row((size_t) w * 3);
+        for (auto y = 0; y < h; ++y) {
+            auto p = &pixels[(size_t) y * w * 4];
+            for (auto x = 0; x < w; ++x) {
+                row[x * 3] = p[x * 4];
+                row[x * 3 + 1] = p[x * 4 + 1];
+                row[x * 3 + 2] = p[x * 4 + 2];
+            }
+            ofs.write((const char *) row.data(), row.size());
+        }
+        return (bool) ofs;
+    }
+
+    bool c2d_raster::read_ppm(const std::string &filename) {
+        std::ifstream ifs(filename, std::ios::binary);
+        std::string magic;
+        int width, height, max;
+        if (!(ifs >> magic >> width >> height >> max) || magic != "P6" || max != 255 || width <= 0 || height <= 0)
+            return false;
+        ifs.get(); // 跳过头部后的一个空白
+        std::vector<uint8_t> rgb((size_t) width * height * 3);
+        if (!ifs.read((char *) rgb.data(), rgb.size()))
+            return false;
+        w = width;
+        h = height;
+        pixels.resize((size_t) w * h * 4);
+        for (size_t i = 0, n = (size_t) w * h; i < n; ++i) {
+            pixels[i * 4] = rgb[i * 3];
+            pixels[i * 4 + 1] = rgb[i * 3 + 1];
+            pixels[i * 4 + 2] = rgb[i * 3 + 2];
+            pixels[i * 4 + 3] = 255;
+        }
+        return true;
+    }
+
+    // PNG：IDAT中使用不压缩的deflate块，不依赖zlib
+    // 参考：https://www.w3.org/TR/PNG/
+    bool c2d_raster::write_png(const std::string &filename) const {
+        static const struct crc_table_t {
+            uint32_t table[256];
+
+            crc_table_t() {
+                for (uint32_t n = 0; n < 256; n++) {
+                    auto c = n;
+                    for (auto k = 0; k < 8; k++)
+                        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                    table[n] = c;
+                }
+            }
+        } crc_table;
+
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs)
+            return false;
+        auto put32 = [](std::vector<uint8_t> &out, uint32_t v) {
+            out.push_back((uint8_t) (v >> 24));
+            out.push_back((uint8_t) (v >> 16));
+            out.push_back((uint8_t) (v >> 8));
+            out.push_back((uint8_t) v);
+        };
+        auto chunk = [&](const char *type, const std::vector<uint8_t> &data) {
+            std::vector<uint8_t> buf;
+            put32(buf, (uint32_t) data.size());
+            buf.insert(buf.end(), type, type + 4);
+            buf.insert(buf.end(), data.begin(), data.end());
+            auto crc = 0xffffffffu;
+            for (size_t i = 4; i < buf.size(); ++i)
+                crc = crc_table.table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+            put32(buf, crc ^ 0xffffffffu);
+            ofs.write((const char *) buf.data(), buf.size());
+        };
+
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        ofs.write((const char *) signature, sizeof(signature));
+
+        std::vector<uint8_t> ihdr;
+        put32(ihdr, (uint32_t) w);
+        put32(ihdr, (uint32_t) h);
+        ihdr.push_back(8); // 位深
+        ihdr.push_back(6); // RGBA
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+        chunk("IHDR", ihdr);
+
+        // 每行前加过滤类型0
+        std::vector<uint8_t> raw;
+        raw.reserve((size_t) h * (w * 4 + 1));
+        for (auto y = 0; y < h; ++y) {
+            raw.push_back(0);
+            auto p = &pixels[(size_t) y * w * 4];
+            raw.insert(raw.end(), p, p + w * 4);
+        }
+        std::vector<uint8_t> idat = {0x78, 0x01}; // zlib头
+        uint32_t a = 1, b = 0; // Adler-32
+        for (size_t pos = 0; pos < raw.size() || pos == 0;) {
+            auto len = std::min<size_t>(raw.size() - pos, 0xffff);
+            auto last = pos + len == raw.size();
+            idat.push_back(last ? 1 : 0);
+            idat.push_back((uint8_t) len);
+            idat.push_back((uint8_t) (len >> 8));
+            idat.push_back((uint8_t) ~len);
+            idat.push_back((uint8_t) (~len >> 8));
+            for (size_t i = pos; i < pos + len; ++i) {
+                idat.push_back(raw[i]);
+                a = (a + raw[i]) % 65521;
+                b = (b + a) % 65521;
+            }
+            pos += len;
+            if (last)
+                break;
+        }
+        put32(idat, b << 16 | a);
+        chunk("IDAT", idat);
+        chunk("IEND", {});
+        return (bool) ofs;
+    }
+
+    size_t c2d_raster::diff(const c2d_raster &a, const c2d_raster &b, int tolerance) {
+        if (a.w != b.w || a.h != b.h)
+            return (size_t) std::max(a.w * a.h, b.w * b.h);
+        size_t count = 0;
+        for (size_t i = 0; i < a.pixels.size(); i += 4) {
+            for (auto k = 0; k < 3; ++k) {
+                if (std::abs(a.pixels[i + k] - b.pixels[i + k]) > tolerance) {
+                    ++count;
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+
+    int c2d_raster::width() const {
+        return w;
+    }
+
+    int c2d_raster::height() const {
+        return h;
+    }
+
+    const uint8_t *c2d_raster::data() const {
+        return pixels.data();
+    }
+}
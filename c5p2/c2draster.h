@@ -0,0 +1,52 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DRASTER_H
+#define CLIB2D_C2DRASTER_H
+
+#include <vector>
+#include <string>
+#include "c2drender.h"
+
+namespace clib {
+
+    // 软件光栅化后端，不需要GPU和窗口
+    // 把绘制批次（与OpenGL后端相同的图元）画到内存中的RGBA缓冲区，可输出PPM/PNG，可做逐像素比较
+    class c2d_raster {
+    public:
+        c2d_raster(int width, int height);
+
+        // 视口：center为画面中心的世界坐标，half_height为画面半高（世界单位）
+        // 默认与窗口的透视投影一致（45度视角，距离10）
+        void set_view(const v2 &center, decimal half_height);
+
+        void clear(const c2d_color &c = {0.0f, 0.0f, 0.0f});
+        void render(const c2d_render_batch &batch);
+
+        bool write_ppm(const std::string &filename) const;
+        bool write_png(const std::string &filename) const;
+        bool read_ppm(const std::string &filename); // 读入参考图，尺寸以文件为准
+
+        // 逐像素比较，任一通道相差超过tolerance即算不同，返回不同的像素数（尺寸不同时返回总像素数）
+        static size_t diff(const c2d_raster &a, const c2d_raster &b, int tolerance = 0);
+
+        int width() const;
+        int height() const;
+        const uint8_t *data() const; // RGBA，自上而下逐行
+
+    private:
+        void plot(int x, int y, const c2d_color &c);
+        void fill(int x, int y, int size, const c2d_color &c);
+        void draw_line(float x0, float y0, float x1, float y1, const c2d_color &c, int size);
+        void to_screen(float x, float y, float &sx, float &sy) const;
+
+        int w, h;
+        std::vector<uint8_t> pixels;
+        v2 view_center;
+        decimal view_scale{1}; // 每世界单位的像素数
+    };
+}
+
+#endif //CLIB2D_C2DRASTER_H
@@ -0,0 +1,89 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2drender.h"
+
+namespace clib {
+
+    // 单位圆顶点表，避免每帧重复计算三角函数
+    static const struct unit_circle_t {
+        v2 table[CIRCLE_N];
+
+        unit_circle_t() {
+            for (auto i = 0; i < CIRCLE_N; i++) {
+                const auto arc = PI2 * i / CIRCLE_N;
+                table[i] = v2(std::cos(arc), std::sin(arc));
+            }
+        }
+    } unit_circle;
+
+    c2d_render_batch::group &c2d_render_batch::find(std::vector<group> &groups, float size) {
+        for (auto &g : groups) {
+            if (g.size == size)
+                return g;
+        }
+        groups.push_back(group{size, {}});
+        return groups.back();
+    }
+
+    void c2d_render_batch::line(const v2 &a, const v2 &b, const c2d_color &c, float width) {
+        auto &vs = find(line_groups, width).vertices;
+        vs.push_back({(float) a.x, (float) a.y, c.r, c.g, c.b, c.a});
+        vs.push_back({(float) b.x, (float) b.y, c.r, c.g, c.b, c.a});
+    }
+
+    void c2d_render_batch::loop(const v2 *pts, size_t n, const c2d_color &c, float width) {
+        if (n < 2)
+            return;
+        auto &vs = find(line_groups, width).vertices;
+        for (size_t i = 0; i < n; ++i) {
+            const auto &a = pts[i];
+            const auto &b = pts[i + 1 == n ? 0 : i + 1];
+            vs.push_back({(float) a.x, (float) a.y, c.r, c.g, c.b, c.a});
+            vs.push_back({(float) b.x, (float) b.y, c.r, c.g, c.b, c.a});
+        }
+    }
+
+    void c2d_render_batch::rect(const v2 &min, const v2 &max, const c2d_color &c, float width) {
+        v2 pts[4] = {
+            {min.x, min.y},
+            {min.x, max.y},
+            {max.x, max.y},
+            {max.x, min.y}
+        };
+        loop(pts, 4, c, width);
+    }
+
+    void c2d_render_batch::circle(const v2 &center, decimal r, const c2d_color &c, float width) {
+        auto table = unit_circle.table;
+        auto &vs = find(line_groups, width).vertices;
+        auto prev = center + table[CIRCLE_N - 1] * r;
+        for (auto i = 0; i < CIRCLE_N; i++) {
+            auto cur = center + table[i] * r;
+            vs.push_back({(float) prev.x, (float) prev.y, c.r, c.g, c.b, c.a});
+            vs.push_back({(float) cur.x, (float) cur.y, c.r, c.g, c.b, c.a});
+            prev = cur;
+        }
+    }
+
+    void c2d_render_batch::point(const v2 &p, const c2d_color &c, float size) {
+        find(point_groups, size).vertices.push_back({(float) p.x, (float) p.y, c.r, c.g, c.b, c.a});
+    }
+
+    void c2d_render_batch::clear() {
+        for (auto &g : line_groups)
+            g.vertices.clear();
+        for (auto &g : point_groups)
+            g.vertices.clear();
+    }
+
+    const std::vector<c2d_render_batch::group> &c2d_render_batch::lines() const {
+        return line_groups;
+    }
+
+    const std::vector<c2d_render_batch::group> &c2d_render_batch::points() const {
+        return point_groups;
+    }
+}
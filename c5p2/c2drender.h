@@ -0,0 +1,60 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DRENDER_H
+#define CLIB2D_C2DRENDER_H
+
+#include <vector>
+#include "c2d.h"
+#include "v2.h"
+
+namespace clib {
+
+    // 颜色
+    struct c2d_color {
+        float r, g, b, a;
+
+        c2d_color(float _r, float _g, float _b, float _a = 1.0f) : r(_r), g(_g), b(_b), a(_a) {}
+    };
+
+    // 绘制批次：物体的draw()只把图元写进来，由后端一次性提交
+    // 线段按线宽分组、点按点大小分组，每组是一段连续的顶点数组，一组一次绘制调用
+    class c2d_render_batch {
+    public:
+        struct vertex {
+            float x, y;
+            float r, g, b, a;
+        };
+
+        struct group {
+            float size; // 线宽或点大小
+            std::vector<vertex> vertices;
+        };
+
+        void line(const v2 &a, const v2 &b, const c2d_color &c, float width = 1.0f);
+        // 闭合折线（拆成线段）
+        void loop(const v2 *pts, size_t n, const c2d_color &c, float width = 1.0f);
+        void rect(const v2 &min, const v2 &max, const c2d_color &c, float width = 1.0f);
+        void circle(const v2 &center, decimal r, const c2d_color &c, float width = 1.0f);
+        void point(const v2 &p, const c2d_color &c, float size = 1.0f);
+
+        // 清空图元，保留已申请的内存
+        void clear();
+
+        const std::vector<group> &lines() const;
+        const std::vector<group> &points() const;
+
+    private:
+        static group &find(std::vector<group> &groups, float size);
+
+        std::vector<group> line_groups;
+        std::vector<group> point_groups;
+    };
+
+    // OpenGL后端：用顶点数组提交整个批次
+    void c2d_render_gl(const c2d_render_batch &batch);
+}
+
+#endif //CLIB2D_C2DRENDER_H
@@ -0,0 +1,48 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include <GL/freeglut.h>
+#include "c2drender.h"
+
+namespace clib {
+
+    // 顶点数组是GL 1.1的功能，不需要加载扩展
+    // 每个线宽、点大小各一次glDrawArrays
+    void c2d_render_gl(const c2d_render_batch &batch) {
+        const auto stride = (GLsizei) sizeof(c2d_render_batch::vertex);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+
+        // 开启反走样
+        glEnable(GL_BLEND);
+        glEnable(GL_LINE_SMOOTH);
+        glHint(GL_LINE_SMOOTH_HINT, GL_FASTEST);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        for (auto &g : batch.lines()) {
+            if (g.vertices.empty())
+                continue;
+            glLineWidth(g.size);
+            glVertexPointer(2, GL_FLOAT, stride, &g.vertices[0].x);
+            glColorPointer(4, GL_FLOAT, stride, &g.vertices[0].r);
+            glDrawArrays(GL_LINES, 0, (GLsizei) g.vertices.size());
+        }
+        glDisable(GL_BLEND);
+        glDisable(GL_LINE_SMOOTH);
+        glLineWidth(1.0f);
+
+        for (auto &g : batch.points()) {
+            if (g.vertices.empty())
+                continue;
+            glPointSize(g.size);
+            glVertexPointer(2, GL_FLOAT, stride, &g.vertices[0].x);
+            glColorPointer(4, GL_FLOAT, stride, &g.vertices[0].r);
+            glDrawArrays(GL_POINTS, 0, (GLsizei) g.vertices.size());
+        }
+        glPointSize(1.0f);
+
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+}
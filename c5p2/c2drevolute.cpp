@@ -3,13 +3,16 @@
 // Created by bajdcc
 //
 
-#include <GL/freeglut.h>
 #include "c2drevolute.h"
 #include "c2dworld.h"
 
 namespace clib {
 
-    void c2d_revolute_joint::prepare(const v2 &gravity) {
+    c2d_joint_t c2d_revolute_joint::type() const {
+        return C2D_JOINT_REVOLUTE;
+    }
+
+    void c2d_revolute_joint::prepare() {
         static const auto kBiasFactor = 0.2;
         auto &a = *this->a;
         auto &b = *this->b;
@@ -21,17 +24,11 @@ namespace clib {
         mass = k.inv();
         bias = -kBiasFactor * c2d_world::dt_inv * (b.world() + rb - a.world() - ra);
 
-        a.update(gravity, 0);
-        b.update(gravity, 0); // 初始化力和力矩
-
-        a.impulse(-p, ra);
-        b.impulse(p, rb);
-
-        a.update(gravity, 1);
-        b.update(gravity, 1); // 计算力和力矩，得出速度和角速度
+        a.apply_impulse(-p, ra);
+        b.apply_impulse(p, rb);
     }
 
-    void c2d_revolute_joint::update(const v2 &gravity) {
+    void c2d_revolute_joint::solve() {
         auto &a = *this->a;
         auto &b = *this->b;
         auto dv = (a.V + (-a.angleV * ra.N())) -
@@ -39,36 +36,18 @@ namespace clib {
         p = mass * (dv + bias);
         if (!p.zero(EPSILON)) {
             p_acc = p;
-
-            a.update(gravity, 0);
-            b.update(gravity, 0); // 初始化力和力矩
-
-            a.impulse(-p, ra);
-            b.impulse(p, rb);
-
-            a.update(gravity, 1);
-            b.update(gravity, 1); // 计算力和力矩，得出速度和角速度
+            a.apply_impulse(-p, ra);
+            b.apply_impulse(p, rb);
         }
     }
 
-    void c2d_revolute_joint::draw() {
-        auto centerA = a->world();
-        auto anchorA = world_anchor_a();
-        auto centerB = b->world();
-        auto anchorB = world_anchor_b();
-
-        auto str = std::min(std::log2(1 + p_acc.magnitude()), 10.0) * 0.08;
-        glColor3d(1 - str, 0.2, 0.2 + str);
-        glBegin(GL_LINES);
-        if (!a->statics) {
-            glVertex2d(centerA.x, centerA.y);
-            glVertex2d(anchorA.x, anchorA.y);
-        }
-        if (!b->statics) {
-            glVertex2d(centerB.x, centerB.y);
-            glVertex2d(anchorB.x, anchorB.y);
-        }
-        glEnd();
+    void c2d_revolute_joint::draw(c2d_render_batch &batch) {
+        auto str = (float) (std::min<decimal>(std::log2(1 + p_acc.magnitude()), 10) * 0.08);
+        c2d_color color{1 - str, 0.2f, 0.2f + str};
+        if (!a->statics)
+            batch.line(a->world(), world_anchor_a(), color);
+        if (!b->statics)
+            batch.line(b->world(), world_anchor_b(), color);
     }
 
     v2 c2d_revolute_joint::world_anchor_a() const {
@@ -79,9 +58,9 @@ namespace clib {
         return b->rotate(local_anchor_b) + b->world();
     }
 
-    c2d_revolute_joint::c2d_revolute_joint(c2d_body *_a, c2d_body *_b, const v2 &_anchor) :
-        c2d_joint(_a, _b), anchor(_anchor) {
-        local_anchor_a = m2().rotate(-a->angle).rotate(anchor - a->world());
-        local_anchor_b = m2().rotate(-b->angle).rotate(anchor - b->world());
+    c2d_revolute_joint::c2d_revolute_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b, const v2 &_anchor) :
+        c2d_joint(_id, _a, _b), anchor(_anchor) {
+        local_anchor_a = a->rotate_inv(anchor - a->world());
+        local_anchor_b = b->rotate_inv(anchor - b->world());
     }
 }
\ No newline at end of file
@@ -7,22 +7,25 @@
 #define CLIB2D_C2DREVOLUTE_H
 
 #include "c2djoint.h"
+#include "m2.h"
 
 namespace clib {
     // 旋转关节
-    class c2d_revolute_joint : public c2d_joint {
+    class c2d_revolute_joint final : public c2d_joint {
     public:
-        void prepare(const v2 &gravity) override;
+        c2d_joint_t type() const override;
 
-        void update(const v2 &gravity) override;
+        void prepare(); // 预处理
 
-        void draw() override;
+        void solve(); // 计算
+
+        void draw(c2d_render_batch &batch) override;
 
         v2 world_anchor_a() const;
 
         v2 world_anchor_b() const;
 
-        c2d_revolute_joint(c2d_body *_a, c2d_body *_b, const v2 &_anchor);
+        c2d_revolute_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b, const v2 &_anchor);
 
         c2d_revolute_joint(const c2d_revolute_joint &) = delete; // 禁止拷贝
         c2d_revolute_joint &operator=(const c2d_revolute_joint &) = delete; // 禁止赋值
@@ -0,0 +1,67 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2dsim.h"
+
+namespace clib {
+
+    c2d_simulator::c2d_simulator(c2d_world *_world) : world(_world) {}
+
+    c2d_simulator::~c2d_simulator() {
+        stop();
+    }
+
+    void c2d_simulator::start() {
+        if (running.exchange(true))
+            return;
+        publish(0); // 先发布一帧，渲染线程不会拿到空快照
+        thread = std::thread(&c2d_simulator::run, this);
+    }
+
+    void c2d_simulator::stop() {
+        if (!running.exchange(false))
+            return;
+        thread.join();
+    }
+
+    const c2d_snapshot &c2d_simulator::snapshot() {
+        snapshots.update();
+        return snapshots.front();
+    }
+
+    void c2d_simulator::publish(decimal fps) {
+        auto &s = snapshots.back();
+        s.batch.clear();
+        world->draw(s.batch);
+        s.collisions = world->get_collision_size();
+        s.sleeping = world->get_sleeping_size();
+        s.alloc = world->get_alloc_size();
+        s.paused = c2d_world::paused;
+        s.fps = fps;
+        s.title = c2d_world::title;
+        snapshots.publish();
+    }
+
+    void c2d_simulator::run() {
+        using clock = std::chrono::steady_clock;
+        const auto span = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(FRAME_SPAN));
+        auto next = clock::now();
+        auto last = next;
+        while (running.load(std::memory_order_relaxed)) {
+            world->step(); // 外部操作在这里统一执行
+
+            auto now = clock::now();
+            auto fps = 1.0 / std::max(std::chrono::duration<double>(now - last).count(), EPSILON);
+            last = now;
+            publish(fps);
+
+            // 锁帧，落后太多时不追赶
+            next += span;
+            if (next < now - span)
+                next = now;
+            std::this_thread::sleep_until(next);
+        }
+    }
+}
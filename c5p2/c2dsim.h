@@ -0,0 +1,89 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DSIM_H
+#define CLIB2D_C2DSIM_H
+
+#include <atomic>
+#include <thread>
+#include "c2dworld.h"
+#include "c2drender.h"
+
+namespace clib {
+
+    // 无锁三缓冲：一个写线程、一个读线程
+    // 写线程写完back后与middle交换并打上新数据标记；读线程发现标记后把middle换到front
+    // 双方都不会等待，读线程总是拿到最近一次完整发布的数据
+    template<class T>
+    class c2d_triple_buffer {
+    public:
+        // 写线程
+        T &back() { return buffers[back_index]; }
+
+        void publish() {
+            auto prev = middle.exchange(back_index | fresh_bit, std::memory_order_acq_rel);
+            back_index = prev & index_mask;
+        }
+
+        // 读线程，有新数据时换到前台，返回是否更新
+        bool update() {
+            if (!(middle.load(std::memory_order_acquire) & fresh_bit))
+                return false;
+            auto prev = middle.exchange(front_index, std::memory_order_acq_rel);
+            front_index = prev & index_mask;
+            return true;
+        }
+
+        const T &front() const { return buffers[front_index]; }
+
+    private:
+        static const int fresh_bit = 4;
+        static const int index_mask = 3;
+
+        T buffers[3];
+        int back_index{0};
+        std::atomic<int> middle{1};
+        int front_index{2};
+    };
+
+    // 渲染快照，模拟线程发布后不再修改
+    struct c2d_snapshot {
+        c2d_render_batch batch;
+        size_t collisions{0};
+        size_t sleeping{0};
+        size_t alloc{0};
+        bool paused{false};
+        decimal fps{0}; // 模拟帧率
+        std::string title;
+    };
+
+    // 模拟线程：按固定帧率调用world->step()，通过三缓冲发布渲染快照
+    // 其他线程不能直接访问world，只能用world->post投递操作，由step()开头统一执行
+    class c2d_simulator {
+    public:
+        explicit c2d_simulator(c2d_world *_world);
+        ~c2d_simulator();
+
+        c2d_simulator(const c2d_simulator &) = delete; // 禁止拷贝
+        c2d_simulator &operator=(const c2d_simulator &) = delete; // 禁止赋值
+
+        void start();
+        void stop();
+
+        // 渲染线程调用，返回最新的快照
+        const c2d_snapshot &snapshot();
+
+    private:
+        void run();
+        void publish(decimal fps);
+
+        c2d_world *world;
+        std::thread thread;
+        std::atomic<bool> running{false};
+        c2d_triple_buffer<c2d_snapshot> snapshots;
+    };
+}
+
+#endif //CLIB2D_C2DSIM_H
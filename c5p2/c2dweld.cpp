@@ -0,0 +1,79 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include "c2dweld.h"
+#include "c2dworld.h"
+
+namespace clib {
+
+    c2d_joint_t c2d_weld_joint::type() const {
+        return C2D_JOINT_WELD;
+    }
+
+    void c2d_weld_joint::prepare() {
+        static const auto kBiasFactor = 0.2;
+        auto &a = *this->a;
+        auto &b = *this->b;
+        ra = a.rotate(local_anchor_a);
+        rb = b.rotate(local_anchor_b);
+        auto iA = a.inv_inertia(), iB = b.inv_inertia();
+        auto k = m2(a.inv_mass() + b.inv_mass()) +
+                 (iA * m2(ra.y * ra.y, -ra.y * ra.x, -ra.y * ra.x, ra.x * ra.x)) +
+                 (iB * m2(rb.y * rb.y, -rb.y * rb.x, -rb.y * rb.x, rb.x * rb.x));
+        mass = k.inv();
+        angular_mass = iA + iB > 0 ? 1 / (iA + iB) : 0;
+        bias = c2d_world::dt_inv * kBiasFactor * (b.world() + rb - a.world() - ra);
+        angular_bias = c2d_world::dt_inv * kBiasFactor * (b.angle - a.angle - reference_angle);
+
+        // 用上一帧的冲量预热
+        a.apply_impulse(-p, ra);
+        b.apply_impulse(p, rb);
+        a.apply_angular_impulse(-L);
+        b.apply_angular_impulse(L);
+    }
+
+    void c2d_weld_joint::solve() {
+        auto &a = *this->a;
+        auto &b = *this->b;
+
+        // 角度约束
+        auto l = -angular_mass * (b.angleV - a.angleV + angular_bias);
+        L += l;
+        a.apply_angular_impulse(-l);
+        b.apply_angular_impulse(l);
+
+        // 锚点约束
+        auto dv = (b.V + (-b.angleV * rb.N())) -
+                  (a.V + (-a.angleV * ra.N()));
+        auto P = -(mass * (dv + bias));
+        p += P;
+        a.apply_impulse(-P, ra);
+        b.apply_impulse(P, rb);
+    }
+
+    void c2d_weld_joint::draw(c2d_render_batch &batch) {
+        const c2d_color color{0.9f, 0.5f, 0.1f};
+        auto anchor = world_anchor_a();
+        if (!a->statics)
+            batch.line(a->world(), anchor, color);
+        if (!b->statics)
+            batch.line(b->world(), world_anchor_b(), color);
+        batch.point(anchor, color, 4.0f);
+    }
+
+    v2 c2d_weld_joint::world_anchor_a() const {
+        return a->rotate(local_anchor_a) + a->world();
+    }
+
+    v2 c2d_weld_joint::world_anchor_b() const {
+        return b->rotate(local_anchor_b) + b->world();
+    }
+
+    c2d_weld_joint::c2d_weld_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b, const v2 &anchor) :
+        c2d_joint(_id, _a, _b), reference_angle(_b->angle - _a->angle) {
+        local_anchor_a = a->rotate_inv(anchor - a->world());
+        local_anchor_b = b->rotate_inv(anchor - b->world());
+    }
+}
@@ -0,0 +1,48 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DWELD_H
+#define CLIB2D_C2DWELD_H
+
+#include "c2djoint.h"
+#include "m2.h"
+
+namespace clib {
+    // 焊接关节：锚点重合且相对角度不变
+    class c2d_weld_joint final : public c2d_joint {
+    public:
+        c2d_joint_t type() const override;
+
+        void prepare(); // 预处理
+
+        void solve(); // 计算
+
+        void draw(c2d_render_batch &batch) override;
+
+        v2 world_anchor_a() const;
+
+        v2 world_anchor_b() const;
+
+        c2d_weld_joint(c2d_handle _id, c2d_body *_a, c2d_body *_b, const v2 &anchor);
+
+        c2d_weld_joint(const c2d_weld_joint &) = delete; // 禁止拷贝
+        c2d_weld_joint &operator=(const c2d_weld_joint &) = delete; // 禁止赋值
+
+        v2 local_anchor_a; // 物体A的锚点（本地坐标）
+        v2 local_anchor_b; // 物体B的锚点（本地坐标）
+        decimal reference_angle{0}; // 创建时的相对角度
+
+        v2 ra; // 物体A重心到锚点
+        v2 rb; // 物体B重心到锚点
+        m2 mass; // 质量矩阵
+        decimal angular_mass{0}; // 角度约束的有效质量
+        v2 bias; // 位置补偿
+        decimal angular_bias{0}; // 角度补偿
+        v2 p; // 冲量累计
+        decimal L{0}; // 角冲量累计
+    };
+}
+
+#endif //CLIB2D_C2DWELD_H
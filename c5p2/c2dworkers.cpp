@@ -0,0 +1,73 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#include <algorithm>
+#include "c2dworkers.h"
+
+namespace clib {
+
+    // 每个线程至少分到这么多项，否则唤醒线程的开销比工作本身还大
+    static const size_t min_span = 64;
+
+    c2d_workers::~c2d_workers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto &t : threads)
+            t.join();
+    }
+
+    void c2d_workers::parallel_for(size_t count, size_t threads, const job_t &fn) {
+        threads = std::min(threads, count / min_span);
+        if (threads <= 1) {
+            fn(0, count);
+            return;
+        }
+        std::unique_lock<std::mutex> busy(dispatch, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            fn(0, count);
+            return;
+        }
+        auto span = (count + threads - 1) / threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (this->threads.size() < threads - 1) {
+                auto id = this->threads.size() + 1;
+                this->threads.emplace_back([this, id]() { run(id); });
+            }
+            job = &fn;
+            this->count = count;
+            this->span = span;
+            pending = this->threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        fn(0, span);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+        job = nullptr;
+    }
+
+    void c2d_workers::run(size_t id) {
+        size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&]() { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+            auto fn = job;
+            auto begin = id * span, end = std::min(begin + span, count);
+            lock.unlock();
+            if (begin < end) // 线程比本次的段数多时没有分到
+                (*fn)(begin, end);
+            lock.lock();
+            if (--pending == 0)
+                done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,48 @@
+//
+// Project: clib2d
+// Created by bajdcc
+//
+
+#ifndef CLIB2D_C2DWORKERS_H
+#define CLIB2D_C2DWORKERS_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace clib {
+
+    // 常驻的工作线程，用于批量查询的分段并行
+    // 线程按需创建、只增不减，析构时才退出；每次分派只需唤醒，不再创建和回收线程
+    class c2d_workers {
+    public:
+        using job_t = std::function<void(size_t, size_t)>;
+
+        c2d_workers() = default;
+        ~c2d_workers();
+
+        c2d_workers(const c2d_workers &) = delete; // 禁止拷贝
+        c2d_workers &operator=(const c2d_workers &) = delete; // 禁止赋值
+
+        // 将[0, count)分成threads段并行处理，每段连续以保证局部性，调用线程处理第一段
+        // 数量太少或者其他线程正在分派时直接在调用线程处理
+        void parallel_for(size_t count, size_t threads, const job_t &fn);
+
+    private:
+        void run(size_t id);
+
+        std::mutex dispatch; // 同一时刻只有一个分派者
+        std::mutex mutex;
+        std::condition_variable wake, done;
+        std::vector<std::thread> threads;
+        const job_t *job{nullptr};
+        size_t count{0}, span{0};
+        size_t generation{0}; // 每次分派加一，工作线程据此发现新任务
+        size_t pending{0}; // 还没完成本次分派的工作线程数
+        bool quit{false};
+    };
+}
+
+#endif //CLIB2D_C2DWORKERS_H
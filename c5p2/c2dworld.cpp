@@ -16,19 +16,26 @@ namespace clib {
     decimal c2d_world::dt_inv = 1.0 * FPS;
     bool c2d_world::paused = false; // 是否暂停
     std::string c2d_world::title("[TITLE]"); // 标题
+    uint32_t c2d_world::seed = 0; // 随机种子
     c2d_world *world = nullptr;
 
+    c2d_world::c2d_world() {
+        collisions.reserve(256);
+    }
+
     c2d_polygon *c2d_world::make_polygon(decimal mass, const std::vector<v2> &vertices, const v2 &pos, bool statics) {
-        auto polygon = std::make_unique<c2d_polygon>(global_id++, mass, vertices);
-        polygon->pos = pos;
-        polygon->refresh();
-        auto obj = polygon.get();
+        auto obj = body_pool.make<c2d_polygon>(mass, vertices);
+        obj->pos = pos;
+        obj->refresh();
+        obj->proxy = broadphase.create_proxy(obj->aabb(), obj);
         if (statics) {
-            polygon->mass.set(inf);
-            polygon->statics = true;
-            static_bodies.push_back(std::move(polygon));
+            obj->mass.set(inf);
+            obj->statics = true;
+            obj->list_index = static_bodies.size();
+            static_bodies.push_back(obj);
         } else {
-            bodies.push_back(std::move(polygon));
+            obj->list_index = bodies.size();
+            bodies.push_back(obj);
         }
         return obj;
     }
@@ -45,43 +52,273 @@ namespace clib {
         return make_polygon(mass, vertices, pos, statics);
     }
 
+    void c2d_world::make_rects(const decimal *mass, const v2 *size, const v2 *pos, c2d_polygon **out, size_t count,
+                               bool statics) {
+        auto &list = statics ? static_bodies : bodies;
+        list.reserve(list.size() + count);
+        body_pool.reserve(count);
+        std::vector<c2d_aabb> aabbs(count);
+        std::vector<c2d_body *> objs(count);
+        std::vector<int> proxies(count);
+        std::vector<v2> vertices(4);
+        for (size_t i = 0; i < count; ++i) {
+            auto w = std::abs(size[i].x);
+            auto h = std::abs(size[i].y);
+            vertices[0] = {w / 2, h / 2}; // 同make_rect，逆时针
+            vertices[1] = {-w / 2, h / 2};
+            vertices[2] = {-w / 2, -h / 2};
+            vertices[3] = {w / 2, -h / 2};
+            auto obj = body_pool.make<c2d_polygon>(mass[i], vertices);
+            obj->pos = pos[i];
+            obj->refresh();
+            if (statics) {
+                obj->mass.set(inf);
+                obj->statics = true;
+            }
+            obj->list_index = list.size();
+            list.push_back(obj);
+            aabbs[i] = obj->aabb();
+            objs[i] = obj;
+            if (out)
+                out[i] = obj;
+        }
+        broadphase.create_proxies(aabbs.data(), objs.data(), proxies.data(), count);
+        for (size_t i = 0; i < count; ++i)
+            objs[i]->proxy = proxies[i];
+    }
+
     c2d_circle *c2d_world::make_circle(decimal mass, decimal r, const v2 &pos, bool statics) {
-        auto circle = std::make_unique<c2d_circle>(global_id++, mass, r);
-        circle->pos = pos;
-        auto obj = circle.get();
+        auto obj = body_pool.make<c2d_circle>(mass, r);
+        obj->pos = pos;
+        obj->proxy = broadphase.create_proxy(obj->aabb(), obj);
         if (statics) {
-            circle->mass.set(inf);
-            circle->statics = true;
-            static_bodies.push_back(std::move(circle));
+            obj->mass.set(inf);
+            obj->statics = true;
+            obj->list_index = static_bodies.size();
+            static_bodies.push_back(obj);
         } else {
-            bodies.push_back(std::move(circle));
+            obj->list_index = bodies.size();
+            bodies.push_back(obj);
         }
         return obj;
     }
 
-    c2d_revolute_joint *c2d_world::make_revolute_joint(c2d_body *a, c2d_body *b, const v2 &anchor) {
-        auto joint = std::make_unique<c2d_revolute_joint>(a, b, anchor);
-        auto obj = joint.get();
-        joints.push_back(std::move(joint));
+    template<class T, class... Args>
+    T *c2d_world::make_joint(c2d_body *a, c2d_body *b, Args &&... args) {
+        auto obj = joint_pool.make<T>(std::forward<Args>(args)...);
+#if ENABLE_SLEEP
+        a->wake();
+        b->wake();
+#endif
+        obj->link();
+        obj->list_index = joints.size();
+        joints.push_back(obj);
         return obj;
     }
 
+    c2d_revolute_joint *c2d_world::make_revolute_joint(c2d_body *a, c2d_body *b, const v2 &anchor) {
+        return make_joint<c2d_revolute_joint>(a, b, a, b, anchor);
+    }
+
+    c2d_distance_joint *c2d_world::make_distance_joint(c2d_body *a, c2d_body *b,
+                                                       const v2 &anchor_a, const v2 &anchor_b) {
+        return make_joint<c2d_distance_joint>(a, b, a, b, anchor_a, anchor_b);
+    }
+
+    c2d_weld_joint *c2d_world::make_weld_joint(c2d_body *a, c2d_body *b, const v2 &anchor) {
+        return make_joint<c2d_weld_joint>(a, b, a, b, anchor);
+    }
+
+    c2d_prismatic_joint *c2d_world::make_prismatic_joint(c2d_body *a, c2d_body *b, const v2 &anchor, const v2 &axis) {
+        return make_joint<c2d_prismatic_joint>(a, b, a, b, anchor, axis);
+    }
+
+    c2d_motor_joint *c2d_world::make_motor_joint(c2d_body *a, c2d_body *b, decimal max_force, decimal max_torque) {
+        return make_joint<c2d_motor_joint>(a, b, a, b, max_force, max_torque);
+    }
+
+    c2d_mouse_joint *c2d_world::make_mouse_joint(c2d_body *body, const v2 &anchor, decimal max_force) {
+        return make_joint<c2d_mouse_joint>(body, body, body, anchor, max_force);
+    }
+
+    // 从列表中O(1)删除（与末尾交换）
+    template<class T>
+    static void swap_remove(std::vector<T *> &list, T *obj) {
+        auto last = list.back();
+        list[obj->list_index] = last;
+        last->list_index = obj->list_index;
+        list.pop_back();
+    }
+
+    void c2d_world::destroy_body(c2d_body *body) {
+#if ENABLE_SLEEP
+        body->wake(); // 所在岛屿失去一个物体，需要重新计算
+#endif
+        // 沿关节链表删除关节
+        while (body->joint_list)
+            destroy_joint(body->joint_list->joint);
+        // 沿接触链表删除碰撞，并唤醒接触的物体
+        while (body->contact_list) {
+            auto c = body->contact_list->c;
+#if ENABLE_SLEEP
+            body->contact_list->other->wake();
+#endif
+            collision_erase(collisions.find(make_id(c->bodyA->id, c->bodyB->id)));
+        }
+        broadphase.destroy_proxy(body->proxy);
+        swap_remove(body->statics ? static_bodies : bodies, body);
+        body_pool.destroy(body->id);
+    }
+
+    bool c2d_world::destroy_body(c2d_handle h) {
+        auto body = body_pool.get(h);
+        if (!body)
+            return false;
+        destroy_body(body);
+        return true;
+    }
+
+    void c2d_world::destroy_joint(c2d_joint *joint) {
+#if ENABLE_SLEEP
+        joint->a->wake();
+        joint->b->wake();
+#endif
+        joint->unlink();
+        swap_remove(joints, joint);
+        joint_pool.destroy(joint->id);
+    }
+
+    bool c2d_world::destroy_joint(c2d_handle h) {
+        auto joint = joint_pool.get(h);
+        if (!joint)
+            return false;
+        destroy_joint(joint);
+        return true;
+    }
+
+    c2d_body *c2d_world::get_body(c2d_handle h) const {
+        return body_pool.get(h);
+    }
+
+    c2d_joint *c2d_world::get_joint(c2d_handle h) const {
+        return joint_pool.get(h);
+    }
+
     c2d_body *c2d_world::find_body(const v2 &pos) {
-        auto body = std::find_if(bodies.begin(), bodies.end(), [&](auto &b) {
-            return b->contains(pos);
+        return query_point(pos);
+    }
+
+    bool c2d_world::raycast(const c2d_ray &ray, c2d_raycast_hit &hit) const {
+        hit.body = nullptr;
+        broadphase.raycast(ray, [&](const c2d_ray &r, int proxy) -> decimal {
+            c2d_raycast_hit h;
+            auto clipped = r;
+            clipped.max_t = hit.body ? hit.t : r.max_t;
+            if (!broadphase.body(proxy)->raycast(clipped, h))
+                return -1; // 未命中，继续
+            hit = h;
+            return h.t; // 缩短射线
+        });
+        return hit.body != nullptr;
+    }
+
+    void c2d_world::raycast(const c2d_ray *rays, c2d_raycast_hit *hits, size_t count, size_t threads) const {
+        if (threads > 1)
+            sync_bodies(); // 避免多个线程同时变换同一物体的顶点
+        workers.parallel_for(count, threads, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+                raycast(rays[i], hits[i]);
+        });
+    }
+
+    size_t c2d_world::query_aabb(const c2d_aabb &aabb, std::vector<c2d_body *> &out) const {
+        auto size = out.size();
+        broadphase.query(aabb, [&](int proxy) {
+            auto body = broadphase.body(proxy);
+            if (body->aabb().overlap(aabb))
+                out.push_back(body);
+            return true;
+        });
+        return out.size() - size;
+    }
+
+    void c2d_world::query_aabb(const c2d_aabb *aabbs, size_t count,
+                               std::vector<c2d_body *> &out, std::vector<size_t> &offsets) const {
+        offsets.resize(count + 1);
+        offsets[0] = out.size();
+        for (size_t i = 0; i < count; ++i) {
+            query_aabb(aabbs[i], out);
+            offsets[i + 1] = out.size();
+        }
+    }
+
+    c2d_body *c2d_world::query_point(const v2 &pt) const {
+        c2d_body *found = nullptr;
+        broadphase.query({pt, pt}, [&](int proxy) {
+            auto body = broadphase.body(proxy);
+            if (!body->contains(pt))
+                return true;
+            found = body;
+            return body->statics; // 找到非静态物体即终止
         });
-        if (body != bodies.end())
-            return (*body).get();
-        return nullptr;
+        return found;
     }
 
-    uint32_t c2d_world::make_id(uint16_t a, uint16_t b) {
-        return std::min(a, b) << 16 | (std::max(a, b));
+    void c2d_world::query_point(const v2 *pts, c2d_body **out, size_t count, size_t threads) const {
+        if (threads > 1)
+            sync_bodies();
+        workers.parallel_for(count, threads, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+                out[i] = query_point(pts[i]);
+        });
     }
 
-    bool c2d_world::collision_detection(const c2d_body::ptr &a, c2d_body::ptr &b) {
-        auto bodyA = a.get();
-        auto bodyB = b.get();
+    size_t c2d_world::overlap_shape(c2d_body *shape, std::vector<c2d_body *> &out) const {
+        auto size = out.size();
+        broadphase.query(shape->aabb(), [&](int proxy) {
+            auto body = broadphase.body(proxy);
+            if (body == shape || !AABB_collide(shape, body))
+                return true;
+            collision::intern a{0}, b{0};
+            if (max_separating_axis(shape, body, a) == 1 && max_separating_axis(body, shape, b) == 1)
+                out.push_back(body);
+            return true;
+        });
+        return out.size() - size;
+    }
+
+    size_t c2d_world::query_contacts(const c2d_body *body, std::vector<c2d_body *> &out) const {
+        auto size = out.size();
+        for (auto e = body->contact_list; e; e = e->next)
+            out.push_back(e->other);
+        return out.size() - size;
+    }
+
+    void c2d_world::sync_bodies() const {
+        for (auto &body : bodies)
+            body->sync();
+        for (auto &body : static_bodies)
+            body->sync();
+    }
+
+    // 同时存在的物体槽位各不相同，用槽位下标组成碰撞的键
+    uint64_t c2d_world::make_id(c2d_handle a, c2d_handle b) {
+        auto x = c2d_object_pool<c2d_body>::index(a), y = c2d_object_pool<c2d_body>::index(b);
+        return (uint64_t) std::min(x, y) << 32 | std::max(x, y);
+    }
+
+#if ENABLE_SLEEP
+    // 仍在运动的物体接触休眠物体时，唤醒对方所在的岛屿
+    // 已经静止的物体只把休眠物体当作静态物体，避免接触点时有时无导致反复唤醒
+    static void wake_by_contact(c2d_body *a, c2d_body *b) {
+        if (a->sleep && !b->sleep && !b->statics && b->sleep_time < SLEEP_TIME)
+            a->wake();
+        else if (b->sleep && !a->sleep && !a->statics && a->sleep_time < SLEEP_TIME)
+            b->wake();
+    }
+#endif
+
+    bool c2d_world::collision_detection(c2d_body *bodyA, c2d_body *bodyB) {
         auto id = make_id(bodyA->id, bodyB->id);
         auto _axis = 0;
 
@@ -94,9 +331,7 @@ namespace clib {
              (_axis == 2 ? true : (max_separating_axis(bodyB, bodyA, c.B) != 1)))) { // 是则不碰撞
             auto prev = collisions.find(id); // 查找下先前是否有碰撞
             if (prev != collisions.end()) { // 先前碰撞过，标记成不碰撞
-                collisions.erase(prev); // 从碰撞数组中删掉
-                bodyA->collision--; // 碰撞次数减一
-                bodyB->collision--;
+                collision_erase(prev); // 从碰撞数组中删掉
             }
             return false; // max_sa < 0 不相交
         }
@@ -105,30 +340,42 @@ namespace clib {
         auto prev = collisions.find(id); // 查找下先前是否有碰撞
         if (prev == collisions.end()) { // 之前没有产生过碰撞
             if (solve_collision(c)) { // 计算碰撞点
-                collisions.insert(std::make_pair(id, c));
+                auto &col = collisions.insert(std::make_pair(id, c)).first->second;
+                collision_link(col); // 挂到两个物体的接触链表上
                 // A和B标记成碰撞
                 bodyA->collision++; // 碰撞次数加一
                 bodyB->collision++;
 #if ENABLE_SLEEP
-                bodyA->sleep = false;
-                bodyB->sleep = false;
+                wake_by_contact(bodyA, bodyB);
 #endif
             }
             return true;
         } else { // 先前产生过碰撞
             if (solve_collision(c)) { // 计算碰撞点
-                clib::collision_update(c, collisions[id]);
-                collisions[id] = c; // 替换碰撞结构
+                auto &old = prev->second;
+                clib::collision_update(c, old);
+                c.edges[0] = old.edges[0]; // 接触边保持不变
+                c.edges[1] = old.edges[1];
+                old = c; // 替换碰撞结构
+#if ENABLE_SLEEP
+                wake_by_contact(bodyA, bodyB);
+#endif
                 return true;
             } else { // 没有碰撞
-                collisions.erase(prev);
-                bodyA->collision--; // 碰撞次数减一
-                bodyB->collision--;
+                collision_erase(prev);
                 return false;
             }
         }
     }
 
+    c2d_world::collision_map::iterator c2d_world::collision_erase(collision_map::iterator it) {
+        auto &c = it->second;
+        collision_unlink(c);
+        c.bodyA->collision--; // 碰撞次数减一
+        c.bodyB->collision--;
+        return collisions.erase(it);
+    }
+
     decltype(auto) c2d_world::sleep_bodies() const {
 #if ENABLE_SLEEP
         return std::count_if(bodies.begin(), bodies.end(), [&](auto &b) {
@@ -140,63 +387,68 @@ namespace clib {
     }
 
     void c2d_world::collision_detection() {
-        auto size = bodies.size();
-        for (size_t i = 0; i < size; i++) {
-            if (bodies[i]->sleep) continue;
-            for (size_t j = 0; j < size; j++) {
-                if (bodies[j]->sleep || i < j)
-                    collision_detection(bodies[i], bodies[j]);
+        for (auto &body : bodies) {
+            auto bodyA = body;
+            if (bodyA->sleep) continue;
+            // 用自身包围盒查询宽检测树，得到可能碰撞的物体
+            broadphase.query(bodyA->aabb(), [&](int proxy) {
+                auto bodyB = broadphase.body(proxy);
+                if (bodyB == bodyA)
+                    return true;
+                if (!bodyB->statics && !bodyB->sleep && bodyB->id < bodyA->id)
+                    return true; // 两个活动物体只检测一次
+                collision_detection(bodyA, bodyB);
+                return true;
+            });
+        }
+    }
+
+    void c2d_world::collision_collect() {
+        // 临时列表从本帧的分配器中申请
+        active_collisions = c2d_arena_vector<collision *>(arena);
+        active_collisions.reserve(collisions.size());
+        for (auto it = collisions.begin(); it != collisions.end();) {
+            auto &c = it->second;
+            auto a = c.bodyA;
+            auto b = c.bodyB;
+            if ((a->statics || a->sleep) && (b->statics || b->sleep)) {
+                ++it; // 休眠的碰撞保留，唤醒后继续使用
+                continue;
             }
-            for (auto &body : static_bodies) {
-                collision_detection(bodies[i], body);
+            if (!AABB_collide(a, b)) {
+                // 宽检测没有返回的碰撞对，包围盒必然已经分离
+                it = collision_erase(it);
+                continue;
             }
+            active_collisions.push_back(&c);
+            ++it;
+        }
+        active_joints.reset();
+        for (auto &joint : joints) {
+            if ((joint->a->statics || joint->a->sleep) && (joint->b->statics || joint->b->sleep))
+                continue;
+            active_joints.add(joint);
         }
     }
 
-    void c2d_world::draw_collision(const collision &c) {
-        glColor3f(0.2f, 0.5f, 0.4f);
+    void c2d_world::draw_collision(c2d_render_batch &batch, const collision &c) {
         // 绘制A、B经过SAT计算出来的边
-        glBegin(GL_LINES);
-        v2 ptA1, ptA2;
-        const auto typeA = c.bodyA->type();
-        const auto typeB = c.bodyB->type();
-        if (!c.bodyA->statics) {
-            if (typeA == C2D_POLYGON) {
-                auto bodyA = dynamic_cast<c2d_polygon *>(c.bodyA);
-                ptA1 = bodyA->vertex(c.A.polygon.idx);
-                ptA2 = bodyA->vertex(c.A.polygon.idx + 1);
-                glVertex2d(ptA1.x, ptA1.y);
-                glVertex2d(ptA2.x, ptA2.y);
-            }
+        const c2d_color edge_color{0.2f, 0.5f, 0.4f};
+        if (!c.bodyA->statics && c.bodyA->type() == C2D_POLYGON) {
+            auto ptA1 = c.bodyA->vertex(c.A.polygon.idx);
+            auto ptA2 = c.bodyA->vertex(c.A.polygon.idx + 1);
+            batch.line(ptA1, ptA2, edge_color);
+            // 绘制A的SAT边法线
+            // auto pt3 = (ptA1 + ptA2) / 2;
+            // batch.line(pt3, pt3 + c.N * 0.3, {0.1f, 0.4f, 0.2f});
         }
-        if (!c.bodyB->statics) {
-            if (typeB == C2D_POLYGON) {
-                auto bodyB = dynamic_cast<c2d_polygon *>(c.bodyB);
-                auto ptB1 = bodyB->vertex(c.B.polygon.idx);
-                auto ptB2 = bodyB->vertex(c.B.polygon.idx + 1);
-                glVertex2d(ptB1.x, ptB1.y);
-                glVertex2d(ptB2.x, ptB2.y);
-            }
+        if (!c.bodyB->statics && c.bodyB->type() == C2D_POLYGON) {
+            batch.line(c.bodyB->vertex(c.B.polygon.idx), c.bodyB->vertex(c.B.polygon.idx + 1), edge_color);
         }
-        glEnd();
-        /*if (!c.bodyA->statics) {
-            // 绘制A的SAT边法线
-            glColor3f(0.1f, 0.4f, 0.2f);
-            glBegin(GL_LINES);
-            auto pt3 = (ptA1 + ptA2) / 2;
-            auto pt4 = pt3 + c.N * 0.3;
-            glVertex2d(pt3.x, pt3.y);
-            glVertex2d(pt4.x, pt4.y);
-            glEnd();
-        }*/
         // 绘制接触点
-        glColor3f(1.0f, 0.2f, 0.2f);
-        glPointSize(2.0f);
-        glBegin(GL_POINTS);
         for (auto &contact : c.contacts) {
-            glVertex2d(contact.pos.x, contact.pos.y);
+            batch.point(contact.pos, {1.0f, 0.2f, 0.2f}, 2.0f);
         }
-        glEnd();
     }
 
     void c2d_world::collision_update(collision &c) {
@@ -210,7 +462,7 @@ namespace clib {
             // 法向力
             auto vn = dv.dot(c.N);
             auto dpn = (-vn + contact.bias) * contact.mass_normal;
-            auto _pn = std::max(contact.pn + dpn, 0.0);
+            auto _pn = std::max<decimal>(contact.pn + dpn, 0);
             dpn = _pn - contact.pn;
             contact.pn = _pn;
 
@@ -231,7 +483,7 @@ namespace clib {
             auto vt = dv.dot(tangent);
             auto dpt = -vt * contact.mass_tangent;
             auto friction = sqrt(a.f * b.f) * contact.pn;
-            auto _pt = std::max(-friction, std::min(friction, contact.pt + dpt));
+            auto _pt = std::max<decimal>(-friction, std::min<decimal>(friction, contact.pt + dpt));
             dpt = _pt - contact.pt;
             contact.pt = _pt;
 
@@ -248,37 +500,146 @@ namespace clib {
     }
 
 #if ENABLE_SLEEP
-    void c2d_world::collision_remove_sleep() {
-        erase_if(collisions, [&](auto &c) {
-            if (c.second.bodyA->statics)
-                return c.second.bodyB->sleep;
-            if (c.second.bodyB->statics)
-                return c.second.bodyA->sleep;
-            return c.second.bodyA->sleep && c.second.bodyB->sleep;
-        });
+    void c2d_world::update_islands() {
+        for (auto body : bodies)
+            body->island = -1;
+        // 从未访问的活动物体出发，沿接触链表和关节链表深度优先遍历得到岛屿
+        // 静态物体和休眠物体不传递，每个物体和每条边只访问一次
+        c2d_arena_vector<c2d_body *> stack(arena);
+        c2d_arena_vector<c2d_body *> members(arena);
+        stack.reserve(bodies.size());
+        members.reserve(bodies.size());
+        auto n = 0;
+        for (auto seed : bodies) {
+            if (seed->sleep || seed->island >= 0)
+                continue;
+            members.clear();
+            auto min_time = inf; // 岛屿中最短的静止时间
+            seed->island = n;
+            stack.push_back(seed);
+            while (!stack.empty()) {
+                auto body = stack.back();
+                stack.pop_back();
+                members.push_back(body);
+                min_time = std::min(min_time, body->sleep_time);
+                auto visit = [&](c2d_body *other) {
+                    if (other->statics || other->sleep || other->island >= 0)
+                        return;
+                    other->island = n;
+                    stack.push_back(other);
+                };
+                for (auto e = body->contact_list; e; e = e->next)
+                    visit(e->other);
+                for (auto e = body->joint_list; e; e = e->next)
+                    visit(e->other);
+            }
+            ++n;
+            // 岛屿中所有物体都静止足够久，才能一起休眠
+            if (min_time < SLEEP_TIME)
+                continue;
+            // 串成环形链表，唤醒任一物体即可唤醒整个岛屿
+            for (size_t i = 0; i < members.size(); ++i) {
+                members[i]->island_next = members[(i + 1) % members.size()];
+                members[i]->fall_asleep();
+            }
+        }
     }
 #endif
 
-    void c2d_world::step() {
-        glMatrixMode(GL_MODELVIEW); // 转换视图开始绘制
-        glLoadIdentity();
-        glTranslatef(0.0f, 0.0f, -10.0f);
+    void c2d_world::post(c2d_command cmd) {
+        commands.push(std::move(cmd));
+    }
+
+    void c2d_world::apply_commands() {
+        c2d_command cmd;
+        while (commands.pop(cmd))
+            apply(cmd);
+    }
 
+    void c2d_world::apply(c2d_command &cmd) {
+        switch (cmd.type) {
+            case C2D_CMD_RECT:
+                make_rect(cmd.value, cmd.vec.x, cmd.vec.y, cmd.pos, cmd.flag);
+                break;
+            case C2D_CMD_CIRCLE:
+                make_circle(cmd.value, cmd.vec.x, cmd.pos, cmd.flag);
+                break;
+            case C2D_CMD_DESTROY:
+                destroy_body(cmd.handle);
+                break;
+            case C2D_CMD_IMPULSE: {
+                auto body = get_body(cmd.handle);
+                if (body && !body->statics) {
+#if ENABLE_SLEEP
+                    body->wake();
+#endif
+                    body->update(gravity, 0);
+                    body->impulse(cmd.vec, cmd.pos - body->world());
+                    body->update(gravity, 1);
+                }
+            }
+                break;
+            case C2D_CMD_GRAVITY:
+                gravity = cmd.vec;
+#if ENABLE_SLEEP
+                for (auto &body : bodies) {
+                    body->wake();
+                }
+#endif
+                break;
+            case C2D_CMD_INVERT_GRAVITY:
+                invert_gravity();
+                break;
+            case C2D_CMD_SCENE:
+                scene(cmd.id);
+                break;
+            case C2D_CMD_MOVE:
+                move(cmd.vec);
+                break;
+            case C2D_CMD_ROTATE:
+                rotate(cmd.value);
+                break;
+            case C2D_CMD_MOUSE:
+                mouse(cmd.pos, cmd.flag);
+                break;
+            case C2D_CMD_MOTION:
+                motion(cmd.pos);
+                break;
+            case C2D_CMD_PAUSE:
+                paused = cmd.flag;
+                break;
+            case C2D_CMD_CALL:
+                if (cmd.fn)
+                    cmd.fn(this);
+                break;
+            default:
+                break;
+        }
+        cmd.fn = nullptr; // 及时释放闭包
+    }
+
+    void c2d_world::step() {
+        apply_commands(); // 暂停时也要执行，否则无法继续
         if (!paused) {
             if (animation_id > 0)
                 run_animation();
+            else if (lisp_gc)
+                lisp_gc = !vm.gc_step(LISP_GC_STEP);
 
+#if ENABLE_ALLOC_COUNT
+            auto alloc_start = c2d_alloc_count();
+#endif
+            arena.reset();
             collision_detection();
+            collision_collect();
 
             // 碰撞预处理
-            for (auto &col : collisions) {
-                collision_prepare(col.second);
+            for (auto col : active_collisions) {
+                collision_prepare(*col);
             }
 
             // 关节预处理
-            for (auto &joint : joints) {
-                joint->prepare(gravity);
-            }
+            active_joints.prepare();
 
             for (auto &body : bodies)
                 body->update(gravity, 4); // 合外力累计清零
@@ -287,14 +648,12 @@ namespace clib {
             for (auto i = 0; i < COLLISION_ITERATIONS; ++i) {
 
                 // 碰撞处理
-                for (auto &col : collisions) {
-                    collision_update(col.second);
+                for (auto col : active_collisions) {
+                    collision_update(*col);
                 }
 
                 // 关节处理
-                for (auto &joint : joints) {
-                    joint->update(gravity);
-                }
+                active_joints.solve();
             }
 
             for (auto &body : bodies) {
@@ -302,47 +661,50 @@ namespace clib {
                 body->update(gravity, 3); // 添加重力
                 body->update(gravity, 1); // 计算力和力矩，得出速度和角速度
                 body->update(gravity, 2); // 计算位移和角度
-                body->update(gravity, 5); // 判定休眠
+                body->update(gravity, 5); // 累计静止时间
             }
-        }
 
 #if ENABLE_SLEEP
-        collision_remove_sleep();
+            update_islands();
+#endif
+
+            // 更新宽检测树
+            for (auto &body : bodies) {
+                if (body->sleep) continue;
+                broadphase.move_proxy(body->proxy, body->aabb(), body->V * dt);
+            }
+#if ENABLE_ALLOC_COUNT
+            alloc_size = c2d_alloc_count() - alloc_start;
 #endif
+        }
+    }
 
+    void c2d_world::draw(c2d_render_batch &batch) {
         for (auto &body : static_bodies) {
-            body->draw();
+            body->draw(batch);
         }
         for (auto &body : bodies) {
-            body->draw();
+            body->draw(batch);
         }
         for (auto &col : collisions) {
-            draw_collision(col.second);
+            draw_collision(batch, col.second);
         }
         for (auto &joint : joints) {
-            joint->draw();
+            joint->draw(batch);
         }
 
         if (mouse_drag) {
-            glLineWidth(1.0f);
-            glColor3f(0.6f, 0.6f, 0.6f);
-            glBegin(GL_LINES);
-            glVertex2d(global_drag.x, global_drag.y);
-            glVertex2d(global_drag.x + global_drag_offset.x, global_drag.y + global_drag_offset.y);
-            glEnd();
-            glColor3f(0.9f, 0.7f, 0.4f);
-            glPointSize(4.0f);
-            glBegin(GL_POINTS);
-            glVertex2d(global_drag.x, global_drag.y);
-            glVertex2d(global_drag.x + global_drag_offset.x, global_drag.y + global_drag_offset.y);
-            glEnd();
+            auto end = global_drag + global_drag_offset;
+            batch.line(global_drag, end, {0.6f, 0.6f, 0.6f});
+            batch.point(global_drag, {0.9f, 0.7f, 0.4f}, 4.0f);
+            batch.point(end, {0.9f, 0.7f, 0.4f}, 4.0f);
         }
     }
 
     void c2d_world::move(const v2 &v) {
         for (auto &body : bodies) {
 #if ENABLE_SLEEP
-            body->sleep = false;
+            body->wake();
 #endif
             body->V += v;
         }
@@ -351,7 +713,7 @@ namespace clib {
     void c2d_world::rotate(decimal d) {
         for (auto &body : bodies) {
 #if ENABLE_SLEEP
-            body->sleep = false;
+            body->wake();
 #endif
             body->angleV += d;
         }
@@ -359,9 +721,9 @@ namespace clib {
 
     void c2d_world::offset(const v2 &pt, const v2 &offset) {
         auto body = find_body(pt);
-        if (body) {
+        if (body && !body->statics) {
 #if ENABLE_SLEEP
-            body->sleep = false;
+            body->wake();
 #endif
             body->drag(pt, offset * body->mass.value);
         }
@@ -392,11 +754,13 @@ namespace clib {
 
     void c2d_world::clear() {
         stop_animation();
-        global_id = 1;
         bodies.clear();
         static_bodies.clear();
         collisions.clear();
         joints.clear();
+        joint_pool.clear();
+        body_pool.clear();
+        broadphase.clear();
     }
 
     void c2d_world::make_bound() {
@@ -406,6 +770,30 @@ namespace clib {
         make_rect(inf, 0.1, 6, {-5, 0}, true)->f = 0.8;
     }
 
+    // 场景用的随机数，引擎和分布都按固定的算法实现
+    // 标准库没有规定default_random_engine和各种分布的算法，同一种子在不同平台上的场景会不一样，画面回归无法比较
+    struct scene_random {
+        explicit scene_random(uint32_t seed) : e(seed) {}
+
+        // [a, b]中的整数
+        int integer(int a, int b) {
+            return a + (int) (e() % (uint32_t) (b - a + 1));
+        }
+
+        // [a, b)中的实数
+        decimal real(decimal a, decimal b) {
+            return (decimal) (a + (b - a) * (e() / 4294967296.0));
+        }
+
+        // 正态分布（Box-Muller）
+        decimal normal(decimal mean, decimal stddev) {
+            auto u1 = (e() + 1.0) / 4294967296.0, u2 = e() / 4294967296.0;
+            return (decimal) (mean + stddev * std::sqrt(-2 * std::log(u1)) * std::cos(2 * M_PI * u2));
+        }
+
+        std::mt19937 e;
+    };
+
     void c2d_world::scene(int id) {
         clear();
         switch (id) {
@@ -425,11 +813,10 @@ namespace clib {
             case 2: { // 堆叠的方块
                 title = "[SCENE 2] Rectangle stack";
                 make_bound();
-                std::default_random_engine e((uint32_t) time(nullptr));
-                std::normal_distribution<decimal> dist{-0.1, 0.1};
+                scene_random e(seed ? seed : (uint32_t) time(nullptr));
                 for (auto i = 0; i < 10; ++i) {
-                    auto x = dist(e);
-                    auto body = make_rect(1, 0.5, 0.4, {x, -2.6 + 0.4 * i});
+                    auto x = e.normal(-0.1, 0.1);
+                    auto body = make_rect(1, 0.5, 0.4, {x, decimal(-2.6 + 0.4 * i)});
                     body->f = 0.2;
                 }
             }
@@ -458,9 +845,9 @@ namespace clib {
                 box1->CO = 0.99;
                 make_revolute_joint(ground, box1, {1.75, 3});
                 for (size_t i = 0; i < 6; ++i) {
-                    auto box2 = make_rect(100, 0.5, 0.5, {1.25 - i * 0.500001, -1});
+                    auto box2 = make_rect(100, 0.5, 0.5, {decimal(1.25 - i * 0.500001), -1});
                     box2->CO = 0.99;
-                    make_revolute_joint(ground, box2, {1.25 - i * 0.500001, 3});
+                    make_revolute_joint(ground, box2, {decimal(1.25 - i * 0.500001), 3});
                 }
             }
                 break;
@@ -472,9 +859,9 @@ namespace clib {
                 const auto y = 3.0;
                 auto last = ground;
                 for (int i = 0; i < 14; ++i) {
-                    auto box = make_rect(mass, 0.4, 0.1, {0.2 + 0.5 * i, y});
+                    auto box = make_rect(mass, 0.4, 0.1, {decimal(0.2 + 0.5 * i), y});
                     box->f = 0.4;
-                    make_revolute_joint(last, box, {0.5 * i, y});
+                    make_revolute_joint(last, box, {decimal(0.5 * i), y});
                     last = box;
                 }
             }
@@ -485,13 +872,11 @@ namespace clib {
                 v2 x{-2.0, -2.4};
                 v2 y;
                 int n = 10;
-                std::default_random_engine e((uint32_t) time(nullptr));
-                std::uniform_real_distribution<decimal> dist{0.15, 0.2};
-                std::uniform_int_distribution<int> dist2{0, 4};
+                scene_random e(seed ? seed : (uint32_t) time(nullptr));
                 for (auto i = 0; i < n; ++i) {
                     y = x;
                     for (auto j = i; j < n; ++j) {
-                        switch (dist2(e)) {
+                        switch (e.integer(0, 4)) {
                             case 1:
                                 make_rect(1, 0.4, 0.4, y)->f = 0.2;
                                 break;
@@ -519,7 +904,7 @@ namespace clib {
                             }
                                 break;
                             default:
-                                make_circle(1, dist(e), y)->f = 0.2;
+                                make_circle(1, e.real(0.15, 0.2), y)->f = 0.2;
                                 break;
                         }
                         y += {0.41, 0.0};
@@ -534,6 +919,40 @@ namespace clib {
                 start_animation(1);
             }
                 break;
+            case 8: { // 各种关节
+                title = "[SCENE 8] Distance, weld, prismatic, motor and mouse joints";
+                make_bound();
+                auto top = static_bodies[0]; // 上边界
+                auto bottom = static_bodies[1]; // 下边界
+                // 距离关节：三节摆
+                v2 pt{-4.5, 2.95};
+                auto last = top;
+                for (int i = 0; i < 3; ++i) {
+                    auto next = pt + v2(0.6, -0.6);
+                    auto ball = make_circle(2, 0.15, next);
+                    make_distance_joint(last, ball, pt, next);
+                    last = ball;
+                    pt = next;
+                }
+                // 焊接关节：两块焊成L形
+                auto bar1 = make_rect(2, 1.2, 0.2, {-2, 1});
+                auto bar2 = make_rect(2, 0.2, 0.8, {-1.5, 1.5});
+                make_weld_joint(bar1, bar2, {-1.5, 1.1});
+                // 滑动关节：沿斜轴滑动的方块，限制在[-1,1]
+                auto slider = make_rect(4, 0.6, 0.3, {1, 0.5});
+                slider->f = 0.2;
+                make_prismatic_joint(top, slider, {1, 0.5}, {1, 1})->set_limit(-1, 1);
+                make_circle(1, 0.2, {0.3, 2})->f = 0.2;
+                // 马达关节：方块被拉回到地面上方的固定位置
+                auto floating = make_rect(2, 0.5, 0.5, {3.5, -1.5});
+                auto motor = make_motor_joint(bottom, floating, 200, 20);
+                motor->linear_offset = {3.5, 1};
+                motor->angular_offset = M_PI / 4;
+                // 鼠标关节：方块一角被拉向目标点
+                auto held = make_rect(1, 0.4, 0.4, {-3, -1.5});
+                make_mouse_joint(held, {-2.8, -1.3}, 100)->set_target({-3.5, 0});
+            }
+                break;
             default: {
                 title = "[SCENE DEFAULT] Rectangle, triangle and circle";
                 make_bound();
@@ -558,17 +977,34 @@ namespace clib {
         return collisions.size();
     }
 
+    size_t c2d_world::get_alloc_size() const {
+        return alloc_size;
+    }
+
     size_t c2d_world::get_sleeping_size() const {
         return sleep_bodies();
     }
 
+    decimal c2d_world::get_energy() const {
+        decimal e = 0;
+        for (auto &body : bodies) {
+            e += body->mass.value * (body->V.magnitude_square() / 2 - gravity.dot(body->pos));
+            e += body->inertia.value * body->angleV * body->angleV / 2;
+        }
+        return e;
+    }
+
+    const std::vector<c2d_body *> &c2d_world::get_bodies() const {
+        return bodies;
+    }
+
     void c2d_world::invert_gravity() {
         gravity.y = gravity.y < 0 ? 0 : GRAVITY;
-        for (auto &body : bodies) {
 #if ENABLE_SLEEP
-            body->sleep = false;
-#endif
+        for (auto &body : bodies) {
+            body->wake();
         }
+#endif
     }
 
     void c2d_world::start_animation(uint32_t id) {
@@ -583,6 +1019,7 @@ namespace clib {
                     vm.prepare(node);
                 } catch (const std::exception &e) {
                     printf("RUNTIME ERROR: %s\n", e.what());
+                    vm.restore();
                     delete parser;
                     parser = nullptr;
                     return;
@@ -604,13 +1041,15 @@ namespace clib {
     void c2d_world::run_animation() {
         try {
             if (vm.run(LISP_CYCLE) != nullptr) {
-                vm.gc();
+                lisp_gc = true; // 剩下的临时对象在之后的帧中回收
                 stop_animation();
+            } else {
+                vm.gc_step(LISP_GC_STEP);
             }
         } catch (const std::exception &e) {
             printf("RUNTIME ERROR: %s\n", e.what());
             vm.restore();
-            vm.gc();
+            lisp_gc = true;
             stop_animation();
         }
     }
@@ -12,8 +12,14 @@
 #include "c2djoint.h"
 #include "c2dpolygon.h"
 #include "c2dcircle.h"
-#include "c2drevolute.h"
+#include "c2djoints.h"
 #include "c2dcollision.h"
+#include "c2dbroadphase.h"
+#include "c2darena.h"
+#include "c2dpool.h"
+#include "c2dcommand.h"
+#include "c2dqueue.h"
+#include "c2dworkers.h"
 #include "cvm.h"
 #include "cparser.h"
 
@@ -21,22 +27,74 @@ namespace clib {
 
     class c2d_world {
     public:
-        c2d_world() = default;
+        // uint64_t 是由 a、b 两个物体句柄的槽位下标组成
+        // 结点由结点池分配，碰撞产生和消失时不用频繁申请堆内存
+        using collision_map = std::unordered_map<uint64_t, collision, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                c2d_pool_allocator<std::pair<const uint64_t, collision>>>;
+
+        c2d_world();
         ~c2d_world() = default;
 
         c2d_polygon *make_polygon(decimal mass, const std::vector<v2> &vertices, const v2 &pos, bool statics = false);
         c2d_polygon *make_rect(decimal mass, decimal w, decimal h, const v2 &pos, bool statics = false);
         c2d_circle *make_circle(decimal mass, decimal r, const v2 &pos, bool statics = false);
+        // 批量创建矩形，size[i]为宽高，out不为空时out[i]为第i个物体
+        // 物体容器预先留好空间，宽检测树一次性插入
+        void make_rects(const decimal *mass, const v2 *size, const v2 *pos, c2d_polygon **out, size_t count,
+                        bool statics = false);
+        // 关节的锚点和轴都用世界坐标
         c2d_revolute_joint *make_revolute_joint(c2d_body *a, c2d_body *b, const v2 &anchor);
+        c2d_distance_joint *make_distance_joint(c2d_body *a, c2d_body *b, const v2 &anchor_a, const v2 &anchor_b);
+        c2d_weld_joint *make_weld_joint(c2d_body *a, c2d_body *b, const v2 &anchor);
+        c2d_prismatic_joint *make_prismatic_joint(c2d_body *a, c2d_body *b, const v2 &anchor, const v2 &axis);
+        c2d_motor_joint *make_motor_joint(c2d_body *a, c2d_body *b, decimal max_force, decimal max_torque);
+        c2d_mouse_joint *make_mouse_joint(c2d_body *body, const v2 &anchor, decimal max_force);
+
+        // 删除物体，同时删除它的碰撞和关节，并唤醒与它接触的物体
+        void destroy_body(c2d_body *body);
+        bool destroy_body(c2d_handle h); // 句柄失效时返回false
+        // 删除关节
+        void destroy_joint(c2d_joint *joint);
+        bool destroy_joint(c2d_handle h);
+
+        // 根据句柄找到物体和关节，句柄失效时返回nullptr
+        c2d_body *get_body(c2d_handle h) const;
+        c2d_joint *get_joint(c2d_handle h) const;
 
         // 根据位置找到物体
         c2d_body *find_body(const v2 &pos);
 
-        static uint32_t make_id(uint16_t a, uint16_t b);
-        bool collision_detection(const c2d_body::ptr &a, c2d_body::ptr &b);
+        // 查询接口（基于宽检测树，包含静态物体，只读）
+        // 顶点按需计算，多个线程同时调用单个查询前要先调用sync_bodies()，批量接口已自动调用
+        // 射线检测，返回是否命中，hit为最近的命中
+        bool raycast(const c2d_ray &ray, c2d_raycast_hit &hit) const;
+        // 批量射线检测，hits[i]对应rays[i]，threads大于1时分段并行
+        void raycast(const c2d_ray *rays, c2d_raycast_hit *hits, size_t count, size_t threads = 1) const;
+        // 包围盒查询，结果追加到out，返回命中个数
+        size_t query_aabb(const c2d_aabb &aabb, std::vector<c2d_body *> &out) const;
+        // 批量包围盒查询，第i个包围盒的结果为out[offsets[i], offsets[i + 1])
+        void query_aabb(const c2d_aabb *aabbs, size_t count,
+                        std::vector<c2d_body *> &out, std::vector<size_t> &offsets) const;
+        // 点查询，优先返回非静态物体
+        c2d_body *query_point(const v2 &pt) const;
+        // 批量点查询，out[i]对应pts[i]
+        void query_point(const v2 *pts, c2d_body **out, size_t count, size_t threads = 1) const;
+        // 形状重叠查询（SAT），shape无需加入世界，结果追加到out，返回命中个数
+        size_t overlap_shape(c2d_body *shape, std::vector<c2d_body *> &out) const;
+        // 与物体接触的物体（沿接触链表），结果追加到out，返回个数
+        size_t query_contacts(const c2d_body *body, std::vector<c2d_body *> &out) const;
+        // 计算所有过期的世界坐标顶点
+        void sync_bodies() const;
+
+        static uint64_t make_id(c2d_handle a, c2d_handle b);
+        bool collision_detection(c2d_body *bodyA, c2d_body *bodyB);
         decltype(auto) sleep_bodies() const;
         // 碰撞检测
         void collision_detection();
+        // 删除碰撞，同时从两个物体的接触链表中摘除
+        collision_map::iterator collision_erase(collision_map::iterator it);
+        // 去除包围盒已经分离的碰撞，收集本帧需要计算的碰撞和关节
+        void collision_collect();
         // https://github.com/erincatto/Box2D/blob/master/Box2D/Dynamics/Contacts/b2ContactSolver.cpp#L127
         // 碰撞计算准备
         void collision_prepare(collision &c) {
@@ -58,23 +116,31 @@ namespace clib {
                           std::abs(a.inertia.inv) * tA * tA +
                           std::abs(b.inertia.inv) * tB * tB;
                 contact.mass_tangent = kt > 0 ? COLL_TANGENT_SCALE / kt : 0.0;
-                contact.bias = -kBiasFactor * dt_inv * std::min(0.0, contact.sep);
+                contact.bias = -kBiasFactor * dt_inv * std::min<decimal>(0, contact.sep);
             }
         }
 
         // 绘制碰撞情况
-        void draw_collision(const collision &c);
+        void draw_collision(c2d_render_batch &batch, const collision &c);
 
         // https://github.com/erincatto/Box2D/blob/master/Box2D/Dynamics/Contacts/b2ContactSolver.cpp#L324
         // 碰撞计算
         void collision_update(collision &c);
 
 #if ENABLE_SLEEP
-        // 去除休眠物体的碰撞
-        void collision_remove_sleep();
+        // 沿接触和关节链表构建岛屿（连在一起的非静态物体），整个岛屿静止足够久后一起休眠
+        void update_islands();
 #endif
 
+        // 投递外部操作，任意线程调用，下一次step()开头统一执行
+        void post(c2d_command cmd);
+        // 执行所有已投递的操作，只能在模拟线程调用
+        void apply_commands();
+
+        // 物理计算一步（不绘制）
         void step();
+        // 把所有物体、碰撞和关节的图元写入批次
+        void draw(c2d_render_batch &batch);
         void move(const v2 &v);
         void rotate(decimal d);
         void offset(const v2 &pt, const v2 &offset);
@@ -95,9 +161,16 @@ namespace clib {
 
         size_t get_collision_size() const;
         size_t get_sleeping_size() const;
+        size_t get_alloc_size() const;
+        decimal get_energy() const; // 非静态物体的机械能（动能、转动动能和重力势能）
+        const std::vector<c2d_body *> &get_bodies() const; // 非静态物体
         void invert_gravity();
 
     private:
+        template<class T, class... Args>
+        T *make_joint(c2d_body *a, c2d_body *b, Args &&... args); // 创建关节，唤醒并连接两个物体
+
+        void apply(c2d_command &cmd);
         void start_animation(uint32_t id);
         void stop_animation();
         void run_animation();
@@ -108,9 +181,11 @@ namespace clib {
         static decimal dt_inv;
         static bool paused; // 是否暂停
         static std::string title; // 标题
+        static uint32_t seed; // 场景的随机种子，0为使用当前时间（固定种子便于回归比较）
 
     private:
         uint32_t animation_id{0};
+        bool lisp_gc{false}; // 脚本结束后还有未完成的回收
         std::string animation_code;
         cvm vm;
         cparser *parser;
@@ -119,14 +194,22 @@ namespace clib {
         v2 global_drag; // 鼠标拖动
         v2 global_drag_offset; // 鼠标拖动位移
 
-        // uint32_t 是由 a、b 两个物体的 id 组成
-        std::unordered_map<uint32_t, collision> collisions; // 碰撞情况
-
-        std::vector<c2d_body::ptr> bodies; // 寻常物体
-        std::vector<c2d_body::ptr> static_bodies; // 静态物体
-        std::vector<c2d_joint::ptr> joints; // 关节
-        uint16_t global_id{1};
+        // 对象池要比引用对象的容器后析构
+        c2d_object_pool<c2d_body> body_pool; // 物体池
+        c2d_object_pool<c2d_joint> joint_pool; // 关节池
+        collision_map collisions; // 碰撞情况
+
+        std::vector<c2d_body *> bodies; // 寻常物体
+        std::vector<c2d_body *> static_bodies; // 静态物体
+        std::vector<c2d_joint *> joints; // 关节
+        c2d_broadphase broadphase; // 宽检测
+        c2d_arena arena; // 每帧的临时数据
+        c2d_arena_vector<collision *> active_collisions{arena}; // 本帧需要计算的碰撞
+        c2d_joint_batch active_joints{arena}; // 本帧需要计算的关节（按类型分组）
+        size_t alloc_size{0}; // 上一帧物理计算中的堆分配次数
         v2 gravity{0, GRAVITY}; // 重力
+        c2d_mpsc_queue<c2d_command> commands; // 外部操作队列（无锁）
+        mutable c2d_workers workers; // 批量查询的工作线程
     };
 
     extern c2d_world *world;
@@ -25,10 +25,6 @@ namespace clib {
     }
 
     ast_node *cast::new_node(ast_t type) {
-        if (nodes.available() < 64) {
-            printf("AST ERROR: 'nodes' out of memory\n");
-            throw std::exception();
-        }
         auto node = nodes.alloc<ast_node>();
         memset(node, 0, sizeof(ast_node));
         node->flag = type;
@@ -108,10 +104,6 @@ namespace clib {
     }
 
     void cast::set_str(ast_node *node, const string_t &str) {
-        if (strings.available() < 64) {
-            printf("AST ERROR: 'strings' out of memory\n");
-            throw std::exception();
-        }
         auto len = str.length();
         auto s = strings.alloc_array<char>(len + 1);
         memcpy(s, str.c_str(), len);
@@ -8,8 +8,8 @@
 
 #include "memory.h"
 
-#define AST_NODE_MEM (32 * 1024)
-#define AST_STR_MEM (16 * 1024)
+#define AST_NODE_MEM (4 * 1024) // 内存池第一段的块数，不够时自动增长
+#define AST_STR_MEM (1 * 1024)
 
 namespace clib {
 
@@ -62,6 +62,9 @@ namespace clib {
             const char *_string;
         } data; // 数据
 
+        // 在源代码中的位置，出错时提示
+        int line, column;
+
         // 树型数据结构，广义表
         ast_node *parent; // 父亲
         ast_node *prev; // 左兄弟
@@ -0,0 +1,301 @@
+//
+// Project: cliblisp
+// Created by bajdcc
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ccompiler.h"
+#include "cvm.h"
+
+namespace clib {
+
+    void ccode::retain() {
+        ref++;
+    }
+
+    void ccode::release() {
+        if (--ref > 0)
+            return;
+        for (auto &child : children)
+            child->release();
+        vm->mem.unprotect(anchor);
+        delete this;
+    }
+
+    ccompiler::ccompiler(cvm *vm) : vm(vm) {}
+
+    ccode *ccompiler::compile(cval *val) {
+        auto src = new_code(val);
+        expr(src, true);
+        emit(i_ret);
+        return code;
+    }
+
+    ccode *ccompiler::compile_body(cval *param, cval *body) {
+        auto src = new_code(body);
+        auto &mem = vm->mem;
+        mem.push_root(code->anchor);
+        code->param = vm->copy(param); // 函数体中的常量会被调用修改，输出用另外一份
+        code->body = vm->copy(body);
+        mem.pop_root();
+        for (auto i = param->val._v.child; i; i = i->next) {
+            auto id = vm->intern(i->val._string);
+            code->params.push_back(id);
+            if (std::find(locals.begin(), locals.end(), id) == locals.end())
+                locals.push_back(id); // 重名的参数后面的值覆盖前面的，共用一个槽位
+        }
+        list(src->val._v.child, src->val._v.count, true);
+        emit(i_ret);
+        return code;
+    }
+
+    cval *ccompiler::new_code(cval *val) {
+        code = new ccode;
+        code->vm = vm;
+        auto &mem = vm->mem;
+        code->anchor = vm->val_obj(ast_qexpr);
+        mem.unlink(code->anchor); // 不挂在当前根下，由protect单独保护
+        mem.protect(code->anchor);
+        if (!val)
+            return nullptr;
+        mem.push_root(code->anchor);
+        auto src = vm->copy(val);
+        mem.pop_root();
+        code->anchor->val._v.child = src;
+        code->anchor->val._v.count = 1;
+        return src;
+    }
+
+    void ccompiler::expr(cval *val, bool tail) {
+        if (!val) {
+            emit(i_nil);
+            return;
+        }
+        switch (val->type) {
+            case ast_sexpr:
+                list(val->val._v.child, val->val._v.count, tail);
+                break;
+            case ast_literal:
+                symbol(val);
+                break;
+            default: // 其余类型求值为自身
+                emit(i_const);
+                emit(constant(val));
+                break;
+        }
+    }
+
+    void ccompiler::symbol(cval *val) {
+        auto id = vm->intern(val->val._string);
+        auto local = std::find(locals.begin(), locals.end(), id);
+        if (local != locals.end()) {
+            emit(i_local);
+            emit((uint) (local - locals.begin()));
+            return;
+        }
+        auto capture = std::find(captures.begin(), captures.end(), id);
+        if (capture != captures.end()) {
+            emit(i_capture);
+            emit((uint) (capture - captures.begin()));
+            emit(id);
+            return;
+        }
+        emit(i_load);
+        emit(id);
+    }
+
+    void ccompiler::list(cval *child, uint count, bool tail) {
+        if (!child) {
+            emit(i_nil);
+        } else if (count == 1) {
+            expr(child, tail);
+        } else {
+            call(child, count, tail);
+        }
+    }
+
+    void ccompiler::call(cval *head, uint count, bool tail) {
+        auto n = count - 1;
+        if (head->type == ast_sub || head->type == ast_lambda) {
+            // 运行时拼出来的代码，函数已经求值，参数原样传入
+            for (auto i = head; i; i = i->next) {
+                emit(i_const);
+                emit(constant(i));
+            }
+            emit(tail ? i_tail : i_call);
+            emit(n);
+            return;
+        }
+        size_t quote = 0;
+        if (head->type == ast_literal) {
+            if (special(head, n, tail))
+                return;
+            if (n == 2 && binary(head, i_calc))
+                return;
+            symbol(head);
+            // 函数是quote时参数不求值，运行时才知道
+            emit(i_quote);
+            emit(constant(head));
+            quote = code->text.size();
+            emit(0);
+        } else {
+            expr(head);
+        }
+        for (auto i = head->next; i; i = i->next) {
+            expr(i);
+        }
+        if (quote)
+            patch(quote);
+        emit(tail ? i_tail : i_call);
+        emit(n);
+    }
+
+    // 参数是字面Q-exp的if、while和lambda以及begin直接编译，不再经过内建函数
+    // 同binary，名字是参数或捕获的变量时不直接编译；前面先放一份按普通调用编译的代码，运行时符号仍绑定着原来的内建函数才跳过它
+    bool ccompiler::special(cval *head, uint n, bool tail) {
+        if (plain)
+            return false;
+        auto name = head->val._string;
+        auto arg = head->next;
+        if (n == 3 && strcmp(name, "if") == 0) {
+            if (arg->next->type != ast_qexpr || arg->next->next->type != ast_qexpr)
+                return false;
+        } else if (n == 2 && (strcmp(name, "while") == 0 || strcmp(name, "\\") == 0)) {
+            if (arg->type != ast_qexpr || arg->next->type != ast_qexpr)
+                return false;
+            if (name[0] == '\\') {
+                for (auto i = arg->val._v.child; i; i = i->next) {
+                    if (i->type != ast_literal)
+                        return false;
+                }
+            }
+        } else if (n == 0 || strcmp(name, "begin") != 0) {
+            return false;
+        }
+        auto id = vm->intern(name);
+        if (std::find(locals.begin(), locals.end(), id) != locals.end() ||
+            std::find(captures.begin(), captures.end(), id) != captures.end())
+            return false;
+        emit(i_native);
+        emit((uint) (name[0] | name[1] << 8));
+        emit(id);
+        auto native = code->text.size();
+        emit(0);
+        // 参数中的特殊形式也按普通调用编译，代码长度不会随嵌套层数翻倍
+        plain = true;
+        call(head, n + 1, tail);
+        plain = false;
+        emit(i_jmp);
+        auto end = code->text.size();
+        emit(0);
+        patch(native);
+        if (name[0] == 'i') {
+            auto cond = arg;
+            auto t = cond->next;
+            auto f = t->next;
+            if (cond->type == ast_sexpr)
+                test(cond->val._v.child, cond->val._v.count);
+            else
+                expr(cond);
+            emit(i_jf);
+            auto jf = code->text.size();
+            emit(0);
+            list(t->val._v.child, t->val._v.count, tail);
+            emit(i_jmp);
+            auto jmp = code->text.size();
+            emit(0);
+            patch(jf);
+            list(f->val._v.child, f->val._v.count, tail);
+            patch(jmp);
+        } else if (name[0] == 'w') {
+            auto cond = arg;
+            auto body = cond->next;
+            // 循环不增加运行帧，值为nil
+            auto loop = (uint) code->text.size();
+            test(cond->val._v.child, cond->val._v.count);
+            emit(i_jf);
+            auto jf = code->text.size();
+            emit(0);
+            list(body->val._v.child, body->val._v.count);
+            emit(i_pop);
+            emit(i_jmp);
+            emit(loop);
+            patch(jf);
+            emit(i_nil);
+        } else if (name[0] == 'b') {
+            auto i = arg;
+            for (; i->next; i = i->next) {
+                expr(i);
+                emit(i_pop);
+            }
+            expr(i, tail);
+        } else {
+            ccompiler sub(vm);
+            sub.captures = locals; // 创建时所在环境本层的变量以参数开头，槽位相同
+            code->children.push_back(sub.compile_body(arg, arg->next));
+            emit(i_lambda);
+            emit((uint) code->children.size() - 1);
+        }
+        patch(end);
+        return true;
+    }
+
+    // 二元的算术和比较，运算符运行时再检查，参数是常量或变量时不入栈，直接读原值
+    bool ccompiler::binary(cval *head, ins_t ins) {
+        static const char *ops[] = {"+", "-", "*", "/", "<", "<=", ">", ">=", "==", "!="};
+        auto name = head->val._string;
+        if (std::find_if(std::begin(ops), std::end(ops),
+                         [name](const char *op) { return strcmp(op, name) == 0; }) == std::end(ops))
+            return false;
+        auto id = vm->intern(name);
+        if (std::find(locals.begin(), locals.end(), id) != locals.end() ||
+            std::find(captures.begin(), captures.end(), id) != captures.end())
+            return false;
+        auto a = head->next;
+        auto b = a->next;
+        // b要求值时a也要先求值入栈，保持求值顺序
+        auto x = operand(a, b->type != ast_sexpr);
+        auto y = operand(b, true);
+        emit(ins);
+        emit((uint) (name[0] | name[1] << 8));
+        emit(id);
+        emit(x);
+        emit(y);
+        return true;
+    }
+
+    // 操作数的编码，低两位0：已求值入栈，1：常量，2：参数的槽位，3：符号
+    uint ccompiler::operand(cval *val, bool raw) {
+        if (raw && val->type == ast_literal) {
+            auto id = vm->intern(val->val._string);
+            auto local = std::find(locals.begin(), locals.end(), id);
+            if (local != locals.end())
+                return (uint) (local - locals.begin()) << 2 | 2;
+            return id << 2 | 3;
+        }
+        if (raw && val->type != ast_sexpr)
+            return constant(val) << 2 | 1;
+        expr(val);
+        return 0;
+    }
+
+    // 条件，后面紧跟i_jf
+    void ccompiler::test(cval *child, uint count) {
+        if (count != 3 || child->type != ast_literal || !binary(child, i_test))
+            list(child, count);
+    }
+
+    uint ccompiler::constant(cval *val) {
+        code->consts.push_back(val);
+        return (uint) code->consts.size() - 1;
+    }
+
+    void ccompiler::emit(uint ins) {
+        code->text.push_back(ins);
+    }
+
+    void ccompiler::patch(size_t pos) {
+        code->text[pos] = (uint) code->text.size();
+    }
+}
@@ -0,0 +1,87 @@
+//
+// Project: cliblisp
+// Created by bajdcc
+//
+
+#ifndef CLIBLISP_CCOMPILER_H
+#define CLIBLISP_CCOMPILER_H
+
+#include <vector>
+#include "types.h"
+
+namespace clib {
+
+    struct cval;
+    class cvm;
+
+    // 字节码指令，操作数紧跟在指令后面
+    enum ins_t {
+        i_nil, // 压入nil
+        i_const, // 压入常量 [k]
+        i_load, // 沿环境链查找符号，压入它的副本 [id]
+        i_local, // 压入参数的副本 [slot]
+        i_capture, // 压入捕获的变量的副本，本层有def定义的变量时退回i_load [slot, id]
+        i_quote, // 栈顶是quote时，改为压入未求值的参数并跳到调用处 [k, target]
+        i_call, // 调用，栈上依次是函数和n个参数 [n]
+        i_tail, // 尾调用，被调用的是lambda时替换当前运行帧，否则同i_call [n]
+        i_calc, // 二元算术和比较，运算符仍是原来的内建函数时直接计算，否则照常调用 [op, id, a, b]
+        i_test, // 同i_calc，后面紧跟i_jf，直接计算时不产生结果，直接跳转 [op, id, a, b]
+        i_native, // 符号仍绑定着原来的内建函数时跳转到直接编译的if、while、begin和lambda，否则往下按普通调用执行 [op, id, target]
+        i_lambda, // 创建lambda [child]
+        i_jmp, // 跳转 [target]
+        i_jf, // 弹出栈顶，为假时跳转 [target]
+        i_pop, // 弹出栈顶
+        i_ret, // 返回栈顶
+    };
+
+    // 编译好的字节码，用引用计数管理
+    // 编译时把源代码拷贝一份挂在anchor下，anchor受GC保护，字节码释放时才解除保护
+    // 常量都指向这份拷贝，所以字节码比产生它的表达式活得久也没关系
+    struct ccode {
+        std::vector<uint> text; // 指令
+        std::vector<cval *> consts; // 常量
+        std::vector<ccode *> children; // lambda的函数体
+        std::vector<uint> params; // lambda的参数（符号编号）
+        cval *param{nullptr}, *body{nullptr}; // lambda的参数和函数体，输出用
+        cval *anchor{nullptr};
+        cvm *vm{nullptr};
+        int ref{1};
+
+        void retain();
+        void release();
+    };
+
+    // 把cval形式的代码编译成字节码
+    // 顶层代码由AST转换而来，lambda函数体和eval的参数在运行时才出现，都走这里
+    // lambda函数体中的参数编译成槽位，直接外层lambda的参数编译成捕获变量的槽位，其余符号运行时查找
+    class ccompiler {
+    public:
+        explicit ccompiler(cvm *vm);
+
+        ccode *compile(cval *val); // 按表达式求值
+        ccode *compile_body(cval *param, cval *body); // 按Q-exp的内容求值（lambda函数体）
+
+    private:
+        cval *new_code(cval *val); // 创建字节码，返回源代码的拷贝
+        void expr(cval *val, bool tail = false); // tail表示处于尾部，求得的值直接返回
+        void symbol(cval *val);
+        void list(cval *child, uint count, bool tail = false);
+        void call(cval *head, uint count, bool tail);
+        bool special(cval *head, uint count, bool tail);
+        bool binary(cval *head, ins_t ins);
+        uint operand(cval *val, bool raw);
+        void test(cval *child, uint count);
+        uint constant(cval *val);
+        void emit(uint ins);
+        void patch(size_t pos);
+
+    private:
+        cvm *vm;
+        ccode *code{nullptr};
+        std::vector<uint> locals; // 参数，下标即槽位
+        std::vector<uint> captures; // 外层lambda的参数
+        bool plain{false}; // 正在编译特殊形式的普通调用版本，其中不再直接编译特殊形式
+    };
+}
+
+#endif //CLIBLISP_CCOMPILER_H
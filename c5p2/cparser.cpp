@@ -89,10 +89,18 @@ namespace clib {
         throw std::exception();
     }
 
+    // 新结点记下当前单词的位置
+    ast_node *cparser::new_node(ast_t type) {
+        auto node = ast.new_node(type);
+        node->line = lexer.get_last_line();
+        node->column = lexer.get_last_column();
+        return node;
+    }
+
     ast_node *cparser::lambda(bool paran) {
         if (paran) {
+            auto node = new_node(ast_sexpr);
             match_operator(op_lparan);
-            auto node = ast.new_node(ast_sexpr);
             while (!lexer.is_operator(op_rparan)) {
                 cast::set_child(node, object());
             }
@@ -103,7 +111,9 @@ namespace clib {
             if (lexer.is_type(l_end)) {
                 return child;
             }
-            auto node = ast.new_node(ast_sexpr);
+            auto node = new_node(ast_sexpr);
+            node->line = child->line;
+            node->column = child->column;
             cast::set_child(node, child);
             while (!lexer.is_type(l_end)) {
                 cast::set_child(node, object());
@@ -121,24 +131,29 @@ namespace clib {
                 return lambda();
             }
             if (lexer.is_operator(op_quote)) {
+                auto line = lexer.get_last_line(), column = lexer.get_last_column();
                 match_operator(op_quote);
                 auto obj = object();
                 if (obj->flag == ast_sexpr) {
                     obj->flag = ast_qexpr;
+                    obj->line = line;
+                    obj->column = column;
                     return obj;
                 } else {
-                    auto node = ast.new_node(ast_qexpr);
+                    auto node = new_node(ast_qexpr);
+                    node->line = line;
+                    node->column = column;
                     cast::set_child(node, obj);
                     return node;
                 }
             }
-            auto node = ast.new_node(ast_literal);
+            auto node = new_node(ast_literal);
             ast.set_str(node, OP_STRING(lexer.get_operator()));
             match_type(l_operator);
             return node;
         }
         if (lexer.is_type(l_identifier)) {
-            auto node = ast.new_node(ast_literal);
+            auto node = new_node(ast_literal);
             ast.set_str(node, lexer.get_identifier());
             match_type(l_identifier);
             return node;
@@ -149,7 +164,7 @@ namespace clib {
             switch (type) {
 #define DEFINE_NODE_INT(t) \
             case l_##t: \
-                node = ast.new_node(ast_##t); \
+                node = new_node(ast_##t); \
                 node->data._##t = lexer.get_##t(); \
                 break;
                 DEFINE_NODE_INT(char)
@@ -171,7 +186,7 @@ namespace clib {
             return node;
         }
         if (lexer.is_type(l_string)) {
-            auto node = ast.new_node(ast_string);
+            auto node = new_node(ast_string);
             ast.set_str(node, lexer.get_string());
             match_type(l_string);
             return node;
@@ -38,6 +38,8 @@ namespace clib {
 
         void error(const string_t &);
 
+        ast_node *new_node(ast_t type);
+
     private:
         lexer_t base_type{l_none};
 
@@ -3,6 +3,7 @@
 // Created by bajdcc
 //
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include "cvm.h"
@@ -19,13 +20,6 @@
 
 namespace clib {
 
-    static void add_builtin(cenv &env, const char *name, cval *val) {
-        env.insert(std::make_pair(name, val));
-#if SHOW_ALLOCATE_NODE
-        printf("[DEBUG] ALLOC | addr: 0x%p, node: %-10s, for builtin\n", val, cast::ast_str(val->type).c_str());
-#endif
-    }
-
     void cvm::builtin_load() {
         // Load init code
         auto codes = std::vector<std::string>{
@@ -63,24 +57,30 @@ namespace clib {
     }
 
     void cvm::builtin_init() {
-        auto &_env = *global_env->val._env.env;
-        add_builtin(_env, "__author__", val_str(ast_string, "bajdcc"));
-        add_builtin(_env, "__project__", val_str(ast_string, "cliblisp"));
-        add_builtin(_env, "+", val_sub("+", builtins::add));
-        add_builtin(_env, "-", val_sub("-", builtins::sub));
-        add_builtin(_env, "*", val_sub("*", builtins::mul));
-        add_builtin(_env, "/", val_sub("/", builtins::div));
-        add_builtin(_env, "\\", val_sub("\\", builtins::lambda));
-        add_builtin(_env, "<", val_sub("<", builtins::lt));
-        add_builtin(_env, "<=", val_sub("<=", builtins::le));
-        add_builtin(_env, ">", val_sub(">", builtins::gt));
-        add_builtin(_env, ">=", val_sub(">=", builtins::ge));
-        add_builtin(_env, "==", val_sub("==", builtins::eq));
-        add_builtin(_env, "!=", val_sub("!=", builtins::ne));
-        add_builtin(_env, "eval", val_sub("eval", builtins::call_eval));
-        add_builtin(_env, "if", val_sub("if", builtins::_if));
-        add_builtin(_env, "null?", val_sub("null?", builtins::is_null));
-#define ADD_BUILTIN(name) add_builtin(_env, #name, val_sub(#name, builtins::name))
+        auto add_builtin = [this](const char *name, cval *val) {
+            env_slot(global_env, intern(name)) = val;
+#if SHOW_ALLOCATE_NODE
+            printf("[DEBUG] ALLOC | addr: 0x%p, node: %-10s, for builtin\n", val, cast::ast_str(val->type).c_str());
+#endif
+        };
+        add_builtin("__author__", val_str(ast_string, "bajdcc"));
+        add_builtin("__project__", val_str(ast_string, "cliblisp"));
+        add_builtin("+", val_sub("+", builtins::add));
+        add_builtin("-", val_sub("-", builtins::sub));
+        add_builtin("*", val_sub("*", builtins::mul));
+        add_builtin("/", val_sub("/", builtins::div));
+        add_builtin("\\", val_sub("\\", builtins::lambda));
+        add_builtin("<", val_sub("<", builtins::lt));
+        add_builtin("<=", val_sub("<=", builtins::le));
+        add_builtin(">", val_sub(">", builtins::gt));
+        add_builtin(">=", val_sub(">=", builtins::ge));
+        add_builtin("==", val_sub("==", builtins::eq));
+        add_builtin("!=", val_sub("!=", builtins::ne));
+        add_builtin("eval", val_sub("eval", builtins::call_eval));
+        add_builtin("if", val_sub("if", builtins::_if));
+        add_builtin("while", val_sub("while", builtins::_while));
+        add_builtin("null?", val_sub("null?", builtins::is_null));
+#define ADD_BUILTIN(name) add_builtin(#name, val_sub(#name, builtins::name))
         ADD_BUILTIN(quote);
         ADD_BUILTIN(list);
         ADD_BUILTIN(car);
@@ -94,6 +94,7 @@ namespace clib {
         ADD_BUILTIN(str);
         ADD_BUILTIN(print);
         ADD_BUILTIN(box);
+        ADD_BUILTIN(boxes);
 #undef ADD_BUILTIN
     }
 
@@ -186,6 +187,39 @@ namespace clib {
         }
     }
 
+    // 同为int或double时的快速路径，不经过calc逐个按类型分派
+    template<class T>
+    static T calc_num(int op, T a, T b) {
+        switch (op) {
+            case '+':
+                return a + b;
+            case '-':
+                return a - b;
+            case '*':
+                return a * b;
+            default:
+                return a / b;
+        }
+    }
+
+    template<class T>
+    static bool test_num(int op, T a, T b) {
+        switch (op) {
+            case '=' | '=' << 8:
+                return a == b;
+            case '!' | '=' << 8:
+                return a != b;
+            case '<' | '=' << 8:
+                return a <= b;
+            case '>' | '=' << 8:
+                return a >= b;
+            case '<':
+                return a < b;
+            default:
+                return a > b;
+        }
+    }
+
     cval *cvm::calc_op(int op, cval *val, cval *env) {
         if (!val)
             error("missing operator");
@@ -240,6 +274,10 @@ namespace clib {
                 auto b = s2.str();
                 return val_bool(a == b);
             }
+            if (v->type == ast_int)
+                return val_bool(test_num(op, v->val._int, v2->val._int));
+            if (v->type == ast_double)
+                return val_bool(test_num(op, v->val._double, v2->val._double));
             return val_bool(calc(op, v->type, v, v2, env) != 0);
         }
         auto r = val_obj(v->type);
@@ -249,7 +287,12 @@ namespace clib {
             while (v) {
                 if (r->type != v->type)
                     error("invalid operator type");
-                calc(op, r->type, r, v, env);
+                if (r->type == ast_int)
+                    r->val._int = calc_num(op, r->val._int, v->val._int);
+                else if (r->type == ast_double)
+                    r->val._double = calc_num(op, r->val._double, v->val._double);
+                else
+                    calc(op, r->type, r, v, env);
                 v = v->next;
             }
         } else {
@@ -258,163 +301,90 @@ namespace clib {
         return r;
     }
 
-    cval *cvm::calc_sub(const char *sub, cval *val, cval *env) {
-        auto op = val->val._v.child->next;
-        if (!isalpha(sub[0])) {
-            if (strlen(sub) <= 2)
-                return calc_op(sub[0] | sub[1] << 8, op, env);
-        }
-        error("not support subroutine yet");
-        return nullptr;
-    }
-
-    static char *sub_name(cval *val) {
-        return (char*)val + sizeof(cval);
-    }
-
-    status_t cvm::eval_one(cvm *vm, cframe *frame) {
-        auto &val = frame->val;
-        auto &env = frame->env;
-        if (frame->arg == nullptr) {
-            return vm->call(eval, val->val._v.child, env, &(cval *&)frame->arg);
-        } else {
-            VM_RET((cval *) frame->arg);
+    bool cvm::calc_native(int op, uint id) {
+        if (shadows[id] != 0)
+            return false;
+        auto &vals = global_env->val._env.env->vals;
+        auto v = id < vals.size() ? vals[id] : nullptr;
+        if (!v || v->type != ast_sub)
+            return false;
+        switch (op) {
+            case '+':
+                return v->val._sub.sub == builtins::add;
+            case '-':
+                return v->val._sub.sub == builtins::sub;
+            case '*':
+                return v->val._sub.sub == builtins::mul;
+            case '/':
+                return v->val._sub.sub == builtins::div;
+            case '=' | '=' << 8:
+                return v->val._sub.sub == builtins::eq;
+            case '!' | '=' << 8:
+                return v->val._sub.sub == builtins::ne;
+            case '<' | '=' << 8:
+                return v->val._sub.sub == builtins::le;
+            case '>' | '=' << 8:
+                return v->val._sub.sub == builtins::ge;
+            case '<':
+                return v->val._sub.sub == builtins::lt;
+            case '>':
+                return v->val._sub.sub == builtins::gt;
+            case 'i' | 'f' << 8:
+                return v->val._sub.sub == builtins::_if;
+            case 'w' | 'h' << 8:
+                return v->val._sub.sub == builtins::_while;
+            case 'b' | 'e' << 8:
+                return v->val._sub.sub == builtins::begin;
+            case '\\':
+                return v->val._sub.sub == builtins::lambda;
+            default:
+                return false;
         }
     }
 
-    status_t cvm::eval_child(cvm *vm, cframe *frame) {
-        auto &val = frame->val;
-        auto &env = frame->env;
-        auto op = val->val._v.child;
-        switch (op->type) {
-            case ast_sub: {
-                auto sub = op->val._sub.sub;
-                return sub(vm, frame);
+    cval *cvm::calc_bin(int op, cval *a, cval *b, cval *env) {
+        if (a->type == b->type) {
+            if (a->type == ast_int) {
+                if (is_comparison(op))
+                    return val_bool(test_num(op, a->val._int, b->val._int));
+                auto r = val_obj(ast_int);
+                r->val._int = calc_num(op, a->val._int, b->val._int);
+                return r;
             }
-            case ast_lambda: {
-                return builtins::call_lambda(vm, frame);
+            if (a->type == ast_double) {
+                if (is_comparison(op))
+                    return val_bool(test_num(op, a->val._double, b->val._double));
+                auto r = val_obj(ast_double);
+                r->val._double = calc_num(op, a->val._double, b->val._double);
+                return r;
             }
-            case ast_sexpr:
-            case ast_literal: {
-                struct tmp_bag {
-                    int step;
-                    bool quote;
-                    cval *v;
-                    cval *local;
-                    cval *i;
-                    cval *r;
-                };
-                if (frame->arg == nullptr) {
-                    auto v = vm->val_obj(val->type);
-                    vm->mem.push_root(v);
-#if SHOW_ALLOCATE_NODE
-                    if (op->type == ast_literal) {
-                        printf("[DEBUG] ALLOC | addr: 0x%p, node: %-10s, count: %lu\n", v,
-                               cast::ast_str(val->type).c_str(),
-                               children_size(val));
-                    } else {
-                        printf("[DEBUG] ALLOC | addr: 0x%p, node: %-10s\n", v, cast::ast_str(op->type).c_str());
-                    }
-#endif
-                    v->val._v.child = nullptr;
-                    v->val._v.count = 0;
-                    auto tmp = vm->eval_tmp.alloc<tmp_bag>();
-                    memset(tmp, 0, sizeof(tmp_bag));
-                    tmp->v = v;
-                    tmp->i = op;
-                    frame->arg = tmp;
-                    return vm->call(eval, op, env, &tmp->local);
-                } else {
-                    auto tmp = (tmp_bag *) frame->arg;
-                    if (tmp->step == 0) {
-                        auto &v = tmp->v;
-                        auto &local = tmp->local;
-                        auto &i = tmp->i;
-                        if (op->type == ast_literal && local->type == ast_sub) {
-                            if (strstr(sub_name(local), "quote")) {
-                                tmp->quote = true;
-                            }
-                        }
-                        v->val._v.child = local;
-                        v->val._v.count = 1;
-                        i = i->next;
-                        if (i) {
-                            if (tmp->quote) {
-                                while (i) {
-                                    v->val._v.count++;
-                                    local->next = i;
-                                    local = local->next;
-                                    i = i->next;
-                                }
-                                tmp->step = 2;
-                                vm->mem.pop_root();
-                                return vm->call(eval, v, env, &tmp->r);
-                            } else {
-                                tmp->step = 1;
-                                v->val._v.count++;
-                                return vm->call(eval, i, env, &tmp->r);
-                            }
-                        } else {
-                            tmp->step = 2;
-                            vm->mem.pop_root();
-                            return vm->call(eval, v, env, &tmp->r);
-                        }
-                    } else if (tmp->step == 1) {
-                        auto &v = tmp->v;
-                        auto &local = tmp->local;
-                        auto &i = tmp->i;
-                        local->next = tmp->r;
-                        local = local->next;
-                        i = i->next;
-                        if (i) {
-                            v->val._v.count++;
-                            return vm->call(eval, i, env, &tmp->r);
-                        } else {
-                            tmp->step = 2;
-                            vm->mem.pop_root();
-                            return vm->call(eval, v, env, &tmp->r);
-                        }
-                    } else if (tmp->step == 2) {
-                        auto r = tmp->r;
-                        vm->eval_tmp.free(tmp);
-                        VM_RET(r);
-                    } else {
-                        vm->error("invalid step in eval");
-                        VM_RET(VM_NIL);
-                    }
-                }
-            }
-            default:
-                break;
         }
-        vm->error("invalid operator type for S-exp");
-        VM_RET(VM_NIL);
+        // 操作数可能是变量的原值，calc_op会改动参数，拷贝一份
+        auto v = copy(a);
+        v->next = copy(b);
+        v->next->next = nullptr;
+        return calc_op(op, v, env);
     }
 
-    status_t cvm::eval(cvm *vm, cframe *frame) {
-        auto &val = frame->val;
-        auto &env = frame->env;
-        if (!val) {
-            VM_RET(VM_NIL);
+    bool cvm::calc_test(int op, cval *a, cval *b, cval *env) {
+        if (a->type == b->type && is_comparison(op)) {
+            if (a->type == ast_int)
+                return test_num(op, a->val._int, b->val._int);
+            if (a->type == ast_double)
+                return test_num(op, a->val._double, b->val._double);
         }
-        switch (val->type) {
-            case ast_sexpr: {
-                if (val->val._v.child) {
-                    if (val->val._v.count == 1) {
-                        return eval_one(vm, frame);
-                    }
-                    return eval_child(vm, frame);
-                } else {
-                    VM_RET(VM_NIL);
-                }
-            }
-            case ast_literal: {
-                VM_RET(vm->calc_symbol(val->val._string, env));
-            }
-            default:
-                break;
+        auto r = calc_bin(op, a, b, env);
+        return !(r->type == ast_int && r->val._int == 0);
+    }
+
+    cval *cvm::calc_sub(const char *sub, cval *val, cval *env) {
+        auto op = val->val._v.child->next;
+        if (!isalpha(sub[0])) {
+            if (strlen(sub) <= 2)
+                return calc_op(sub[0] | sub[1] << 8, op, env);
         }
-        VM_RET(val);
+        error("not support subroutine yet");
+        return nullptr;
     }
 
     status_t builtins::add(cvm *vm, cframe *frame) {
@@ -550,6 +520,17 @@ namespace clib {
 
         if (op2->type != ast_qexpr)
             vm->error("cons need Q-exp for second argument");
+        if (vm->mem.temporary(op2)) {
+            // 第二个参数是刚算出来的表，别处没有引用，直接把第一个参数加到它前面，递归建表不再是平方的
+            vm->mem.push_root(op2);
+            auto head = vm->copy(op);
+            head->next = op2->val._v.child;
+            op2->val._v.child = head;
+            op2->val._v.count++;
+            op2->val._v.key = 0; // 第一个元素变了，缓存的选项名作废
+            vm->mem.pop_root();
+            VM_RET(op2);
+        }
         auto v = vm->val_obj(ast_qexpr);
         vm->mem.push_root(v);
 #if SHOW_ALLOCATE_NODE
@@ -589,20 +570,20 @@ namespace clib {
             }
             param = op->val._v.child;
             vm->mem.push_root(env);
-            auto &_env = *env->val._env.env;
+            cval *last = nullptr;
             for (auto i = 0; i < op->val._v.count; ++i) {
-                auto name = param->val._string;
-                auto old = _env.find(name);
-                if (old != _env.end()) {
-                    vm->mem.unlink(env, old->second);
+                auto v = vm->copy(argument);
+                auto &slot = vm->env_slot(env, vm->intern(param->val._string));
+                if (slot) {
+                    vm->mem.unlink(env, slot);
                 }
-                _env[param->val._string] = vm->copy(argument);
+                last = slot = v;
                 param = param->next;
                 argument = argument->next;
             }
             vm->mem.pop_root();
             if (op->val._v.count == 1) {
-                VM_RET(_env[op->val._v.child->val._string]);
+                VM_RET(last);
             }
             VM_RET(VM_NIL);
         } else {
@@ -628,46 +609,7 @@ namespace clib {
             }
             param = param->next;
         }
-        VM_RET(vm->val_lambda(op, op->next, env));
-    }
-
-    static cval **lambda_env(cval *val) {
-        return (cval **)((char *)val + sizeof(cval));
-    }
-
-    status_t builtins::call_lambda(cvm *vm, cframe *frame) {
-        auto &val = frame->val;
-        auto &env = frame->env;
-        auto op = val->val._v.child;
-        auto param = op->val._lambda.param;
-        auto body = op->val._lambda.body;
-        if (val->val._v.count != param->val._v.count + 1)
-            vm->error("lambda need valid argument size");
-        if (frame->arg == nullptr) {
-            auto &env2 = *lambda_env(op);
-            if (env2 != env)
-                env2->val._env.parent = env;
-            auto _param = param->val._v.child;
-            auto _argument = op->next;
-            auto new_env = vm->new_env(env2);
-            vm->mem.unlink(new_env);
-            auto &_env = *new_env->val._env.env;
-            vm->mem.push_root(new_env);
-            while (_param) {
-                auto name = _param->val._string;
-                _env[name] = vm->copy(_argument);
-                _param = _param->next;
-                _argument = _argument->next;
-            }
-            vm->mem.pop_root();
-            assert(body->type == ast_qexpr);
-            body->type = ast_sexpr;
-            return vm->call(cvm::eval, body, new_env, &(cval *&)frame->arg);
-        } else {
-            auto ret = (cval *) frame->arg;
-            body->type = ast_qexpr;
-            VM_RET(ret);
-        }
+        VM_RET(vm->val_lambda(ccompiler(vm).compile_body(op, op->next), vm->new_capture(env)));
     }
 
     status_t builtins::call_eval(cvm *vm, cframe *frame) {
@@ -687,11 +629,12 @@ namespace clib {
             frame->arg = tmp;
             if (tmp->qexp)
                 op->type = ast_sexpr;
-            return vm->call(cvm::eval, op, env, &tmp->ret);
-        } else {
-            auto tmp = (tmp_bag *) frame->arg;
+            auto r = vm->call(op, env, &tmp->ret); // 编译时拷贝了一份，可以立即还原
             if (tmp->qexp)
                 op->type = ast_qexpr;
+            return r;
+        } else {
+            auto tmp = (tmp_bag *) frame->arg;
             auto ret = tmp->ret;
             vm->eval_tmp.free(tmp);
             VM_RET(ret);
@@ -737,26 +680,61 @@ namespace clib {
         if (val->val._v.count != 4)
             vm->error("if requires 3 args");
         auto op = VM_OP(val);
-        if (frame->arg == nullptr) {
-            auto flag = true;
-            if (op->type == ast_int && op->val._int == 0)
-                flag = false;
-            auto _t = op->next;
-            auto _f = _t->next;
-            if (_t->type != ast_qexpr)
-                vm->error("lambda need Q-exp for true branch");
-            if (_f->type != ast_qexpr)
-                vm->error("lambda need Q-exp for false branch");
-            if (flag) {
-                _t->type = ast_sexpr;
-                return vm->call(cvm::eval, _t, env, &(cval *&) frame->arg);
-            } else {
-                _f->type = ast_sexpr;
-                return vm->call(cvm::eval, _f, env, &(cval *&) frame->arg);
+        auto flag = true;
+        if (op->type == ast_int && op->val._int == 0)
+            flag = false;
+        auto _t = op->next;
+        auto _f = _t->next;
+        if (_t->type != ast_qexpr)
+            vm->error("lambda need Q-exp for true branch");
+        if (_f->type != ast_qexpr)
+            vm->error("lambda need Q-exp for false branch");
+        // 分支是常量，编译时拷贝了一份，可以立即还原
+        // 分支的值就是if的值，分支替换掉if的运行帧
+        auto branch = flag ? _t : _f;
+        branch->type = ast_sexpr;
+        auto r = vm->tail(branch, env);
+        branch->type = ast_qexpr;
+        return r;
+    }
+
+    status_t builtins::_while(cvm *vm, cframe *frame) {
+        auto &val = frame->val;
+        auto &env = frame->env;
+        if (val->val._v.count != 3)
+            vm->error("while requires 2 args");
+        auto _cond = VM_OP(val);
+        auto _body = _cond->next;
+        if (_cond->type != ast_qexpr)
+            vm->error("while need Q-exp for condition");
+        if (_body->type != ast_qexpr)
+            vm->error("while need Q-exp for body");
+        struct tmp_bag {
+            bool body; // 刚求值的是循环体
+            cval *ret;
+        };
+        auto tmp = (tmp_bag *) frame->arg;
+        if (tmp == nullptr) {
+            tmp = vm->eval_tmp.alloc<tmp_bag>();
+            memset(tmp, 0, sizeof(tmp_bag));
+            tmp->body = true;
+            frame->arg = tmp;
+        }
+        auto branch = _cond;
+        if (!tmp->body) {
+            auto r = tmp->ret;
+            if (r->type == ast_int && r->val._int == 0) {
+                vm->eval_tmp.free(tmp);
+                VM_RET(VM_NIL);
             }
-        } else {
-            VM_RET((cval *) frame->arg);
+            branch = _body;
         }
+        tmp->body = !tmp->body;
+        // 条件和循环体是常量，编译时拷贝了一份，可以立即还原
+        branch->type = ast_sexpr;
+        auto r = vm->call(branch, env, &tmp->ret);
+        branch->type = ast_qexpr;
+        return r;
     }
 
     status_t builtins::len(cvm *vm, cframe *frame) {
@@ -870,34 +848,188 @@ namespace clib {
         VM_RET(VM_NIL);
     }
 
+    // 关键字表，所有签名共用，编号从1开始
+    static std::unordered_map<std::string, uint> &keywords() {
+        static std::unordered_map<std::string, uint> table;
+        return table;
+    }
+
+    csignature::csignature(const char *name, std::initializer_list<coption> options)
+            : name(name), options(options) {
+        auto &table = keywords();
+        for (auto &opt : this->options) {
+            auto it = table.find(opt.name);
+            if (it == table.end())
+                it = table.insert({opt.name, (uint) table.size() + 1}).first;
+            keys.push_back(it->second);
+        }
+    }
+
+    // 选项名可以是符号、字符串或者只有一个符号的Q-exp（用list拼选项时）
+    uint csignature::keyword(cval *name) {
+        if (name->type == ast_qexpr && name->val._v.count == 1) {
+            if (name->val._v.key)
+                return name->val._v.key;
+            name = name->val._v.child;
+        }
+        if (name->type != ast_literal && name->type != ast_string)
+            return 0;
+        auto &table = keywords();
+        auto it = table.find(name->val._string);
+        return it == table.end() ? 0 : it->second;
+    }
+
+    int csignature::match(cval *opt, string_t &err) const {
+        if (opt->type != ast_qexpr || opt->val._v.count == 0) {
+            err = "expect option `(name value...)";
+            return -1;
+        }
+        auto key = opt->val._v.key;
+        if (!key)
+            key = opt->val._v.key = keyword(opt->val._v.child); // 运行时拼出来的选项，解析一次后缓存
+        auto it = std::find(keys.begin(), keys.end(), key);
+        if (it == keys.end()) {
+            err = "unknown option";
+            return -1;
+        }
+        auto slot = (int) (it - keys.begin());
+        auto &o = options[slot];
+        if (opt->val._v.count != o.count + 1) {
+            err = string_t("option ") + o.name + " requires " + std::to_string(o.count) + " values";
+            return -1;
+        }
+        for (auto i = opt->val._v.child->next; i; i = i->next) {
+            if (!(o.types & 1U << i->type)) {
+                err = string_t("invalid value of option ") + o.name;
+                return -1;
+            }
+        }
+        return slot;
+    }
+
+    void csignature::parse(cvm *vm, cval *opts, cval **slots) const {
+        string_t err;
+        for (auto i = opts; i; i = i->next) {
+            auto slot = match(i, err);
+            if (slot < 0)
+                vm->error(string_t(name) + ": " + err);
+            slots[slot] = i->val._v.child->next;
+        }
+    }
+
+    enum box_option_t {
+        box_x, box_y, box_w, box_h, box_mass, box_options,
+    };
+
+    enum box_slot_t {
+        slot_pos, slot_size, slot_mass, box_slots,
+    };
+
+    static const csignature box_signature("box", {
+            {"pos",  2, o_number},
+            {"size", 2, o_number},
+            {"mass", 1, o_number},
+    });
+
+    static const csignature boxes_signature("boxes", {
+            {"pos",  2, o_number | o_vector},
+            {"size", 2, o_number | o_vector},
+            {"mass", 1, o_number | o_vector},
+    });
+
+    const csignature *builtins::signature(csub sub) {
+        if (sub == box)
+            return &box_signature;
+        if (sub == boxes)
+            return &boxes_signature;
+        return nullptr;
+    }
+
+    // box和boxes的选项：`(pos x y) `(size w h) `(mass m)，vals按box_option_t存放选项的值
+    static void box_option(cvm *vm, const csignature &sig, cval *opts, cval **vals) {
+        cval *slots[box_slots]{};
+        sig.parse(vm, opts, slots);
+        if (slots[slot_pos]) {
+            vals[box_x] = slots[slot_pos];
+            vals[box_y] = slots[slot_pos]->next;
+        }
+        if (slots[slot_size]) {
+            vals[box_w] = slots[slot_size];
+            vals[box_h] = slots[slot_size]->next;
+        }
+        vals[box_mass] = slots[slot_mass];
+    }
+
+    static bool box_number(cval *val, decimal &d) {
+        if (val->type == ast_double)
+            d = val->val._double;
+        else if (val->type == ast_int)
+            d = val->val._int;
+        else
+            return false;
+        return true;
+    }
+
     status_t builtins::box(cvm *vm, cframe *frame) {
         auto &val = frame->val;
-        auto i = VM_OP(val);
-        auto mass = 1.0;
-        auto w = 0.0;
-        auto h = 0.0;
-        auto pos = v2();
-        while (i) {
-            if (i->type == ast_qexpr && i->val._v.count > 1 && i->val._v.child->type == ast_literal) {
-                auto op = i->val._v.child;
-                auto count = i->val._v.count;
-                auto str = op->val._string;
-                if (strstr(str, "mass") && count == 2 && op->next->type == ast_double) {
-                    mass = op->next->val._double;
-                } else if (strstr(str, "size") && count == 3 && op->next->type == ast_double && op->next->next->type == ast_double) {
-                    w = op->next->val._double;
-                    h = op->next->next->val._double;
-                } else if (strstr(str, "pos") && count == 3 && op->next->type == ast_double && op->next->next->type == ast_double) {
-                    pos.x = op->next->val._double;
-                    pos.y = op->next->next->val._double;
-                }
-            }
-            i = i->next;
+        cval *vals[box_options]{};
+        box_option(vm, box_signature, VM_OP(val), vals);
+        decimal args[box_options] = {0, 0, 0, 0, 1};
+        for (auto i = 0; i < box_options; ++i) {
+            if (vals[i])
+                box_number(vals[i], args[i]);
         }
-        auto box = world->make_rect(mass, w, h, pos);
+        auto box = world->make_rect(args[box_mass], args[box_w], args[box_h], {args[box_x], args[box_y]});
 #if LISP_DEBUG
         printf("[DEBUG] Create box by lisp.\n");
 #endif
         VM_RET(VM_NIL);
     }
+
+    // 批量创建矩形，选项同box，每个值也可以是数的Q-exp，第i个物体取第i项，返回创建的个数
+    status_t builtins::boxes(cvm *vm, cframe *frame) {
+        auto &val = frame->val;
+        cval *vals[box_options]{};
+        box_option(vm, boxes_signature, VM_OP(val), vals);
+        size_t count = 1;
+        auto vector = false;
+        for (auto v : vals) {
+            if (!v || v->type != ast_qexpr)
+                continue;
+            if (vector && v->val._v.count != count)
+                vm->error("boxes requires vectors of the same size");
+            count = v->val._v.count;
+            vector = true;
+        }
+        static const decimal defaults[box_options] = {0, 0, 0, 0, 1};
+        std::vector<decimal> args[box_options];
+        for (auto i = 0; i < box_options; ++i) {
+            auto v = vals[i];
+            decimal d = defaults[i];
+            if (v && v->type == ast_qexpr) {
+                args[i].reserve(count);
+                for (auto j = v->val._v.child; j; j = j->next) {
+                    if (!box_number(j, d))
+                        vm->error("boxes requires numbers");
+                    args[i].push_back(d);
+                }
+            } else {
+                if (v)
+                    box_number(v, d);
+                args[i].assign(count, d);
+            }
+        }
+        std::vector<v2> size(count), pos(count);
+        for (size_t i = 0; i < count; ++i) {
+            size[i] = {args[box_w][i], args[box_h][i]};
+            pos[i] = {args[box_x][i], args[box_y][i]};
+        }
+        world->make_rects(args[box_mass].data(), size.data(), pos.data(), nullptr, count);
+#if LISP_DEBUG
+        printf("[DEBUG] Create %d boxes by lisp.\n", (int) count);
+#endif
+        auto n = vm->val_obj(ast_int);
+        n->val._int = (int) count;
+        VM_RET(n);
+    }
 }
\ No newline at end of file
@@ -12,6 +12,37 @@ namespace clib {
     struct cval;
     class cvm;
 
+    // 选项值允许的类型，按ast_t取位
+    enum coption_t : uint {
+        o_number = 1U << ast_int | 1U << ast_double,
+        o_vector = 1U << ast_qexpr, // 数的Q-exp，元素由内建函数自己检查
+    };
+
+    // 内建函数的关键字选项，写成`(name value...)
+    struct coption {
+        const char *name;
+        uint count; // 值的个数
+        uint types; // coption_t
+    };
+
+    // 内建函数的签名，选项名在构造时转成关键字编号，选项Q-exp里缓存编号，调用时按编号找下标，不再比较字符串
+    // 代码里直接写的选项在AST转换时就检查，运行时拼出来的选项调用时检查
+    class csignature {
+    public:
+        csignature(const char *name, std::initializer_list<coption> options);
+
+        static uint keyword(cval *name); // 选项名的关键字编号，不是关键字时为0
+
+        int match(cval *opt, string_t &err) const; // 选项的下标，不匹配时为-1，err为原因
+        void parse(cvm *vm, cval *opts, cval **slots) const; // 按下标填入各选项的第一个值，没给的为空
+
+        const char *name;
+
+    private:
+        std::vector<coption> options;
+        std::vector<uint> keys;
+    };
+
     class builtins {
     public:
         static status_t add(cvm *vm, cframe *frame);
@@ -26,7 +57,6 @@ namespace clib {
 
         static status_t def(cvm *vm, cframe *frame);
         static status_t lambda(cvm *vm, cframe *frame);
-        static status_t call_lambda(cvm *vm, cframe *frame);
         static status_t call_eval(cvm *vm, cframe *frame);
 
         static status_t lt(cvm *vm, cframe *frame);
@@ -38,6 +68,7 @@ namespace clib {
 
         static status_t begin(cvm *vm, cframe *frame);
         static status_t _if(cvm *vm, cframe *frame);
+        static status_t _while(cvm *vm, cframe *frame);
 
         static status_t len(cvm *vm, cframe *frame);
         static status_t append(cvm *vm, cframe *frame);
@@ -49,6 +80,9 @@ namespace clib {
         static status_t print(cvm *vm, cframe *frame);
 
         static status_t box(cvm *vm, cframe *frame);
+        static status_t boxes(cvm *vm, cframe *frame);
+
+        static const csignature *signature(csub sub); // 有关键字选项的内建函数的签名
     };
 }
 
@@ -3,9 +3,12 @@
 // Created by bajdcc
 //
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <stdexcept>
+#include <chrono>
 #include "cvm.h"
 #include "cast.h"
 #include "csub.h"
@@ -15,11 +18,12 @@ namespace clib {
     cvm::cvm() {
         builtin();
         set_free_callback();
+        mem.set_root_callback([this]() { mark_roots(); });
     }
 
     void cvm::builtin() {
         global_env = val_obj(ast_env);
-        global_env->val._env.env = new cval::cenv_t();
+        global_env->val._env.env = new cenv();
         global_env->val._env.parent = nullptr;
         mem.push_root(global_env);
 #if SHOW_ALLOCATE_NODE
@@ -35,6 +39,7 @@ namespace clib {
         auto v = mem.alloc<cval>();
         v->type = type;
         v->next = nullptr;
+        v->val._v.key = 0;
         return v;
     }
 
@@ -73,34 +78,109 @@ namespace clib {
         return v;
     }
 
-    static cval **lambda_env(cval *val) {
-        return (cval **)((char *)val + sizeof(cval));
+    static char *sub_name(cval *val) {
+        return (char*)val + sizeof(cval);
+    }
+
+    static ccapture **lambda_capture(cval *val) {
+        return (ccapture **)((char *)val + sizeof(cval));
     }
 
-    cval *cvm::val_lambda(cval *param, cval *body, cval *env) {
-        auto v = (cval *) mem.alloc(sizeof(cval) + sizeof(cval *));
+    static ccode **lambda_code(cval *val) {
+        return (ccode **)((char *)val + sizeof(cval) + sizeof(ccapture *));
+    }
+
+    // 字节码和捕获的变量在副本之间共享，由调用者增加引用计数
+    cval *cvm::val_lambda(ccode *code, ccapture *capture) {
+        auto v = (cval *) mem.alloc(sizeof(cval) + sizeof(ccapture *) + sizeof(ccode *));
         v->type = ast_lambda;
         v->next = nullptr;
-        mem.push_root(v);
-        v->val._lambda.param = copy(param);
-        v->val._lambda.body = copy(body);
-        if (env == global_env) {
-            *lambda_env(v) = new_env(env);
-        } else {
-            auto _env = *lambda_env(v) = new_env(env->val._env.parent);
-            mem.push_root(_env);
-            auto &_new_env = *_env->val._env.env;
-            for (auto &en : *env->val._env.env) {
-                _new_env.insert(std::make_pair(en.first, copy(en.second)));
-            }
-            mem.pop_root();
+        v->val._lambda.param = code->param;
+        v->val._lambda.body = code->body;
+        *lambda_capture(v) = capture;
+        *lambda_code(v) = code;
+        return v;
+    }
+
+    void ccapture::retain() {
+        ref++;
+    }
+
+    void ccapture::release() {
+        if (--ref > 0)
+            return;
+        for (auto &id : ids)
+            vm->shadows[id]--;
+        vm->mem.unprotect(anchor);
+        delete this;
+    }
+
+    // 捕获env本层的变量，全局环境和没有变量时不需要捕获
+    ccapture *cvm::new_capture(cval *env) {
+        if (env == global_env)
+            return nullptr;
+        auto &_env = *env->val._env.env;
+        if (_env.ids.empty())
+            return nullptr;
+        auto capture = new ccapture;
+        capture->vm = this;
+        capture->anchor = val_obj(ast_qexpr);
+        mem.unlink(capture->anchor); // 不挂在当前根下，由protect单独保护
+        mem.protect(capture->anchor);
+        mem.push_root(capture->anchor);
+        for (size_t i = 0; i < _env.ids.size(); ++i) {
+            capture->ids.push_back(_env.ids[i]);
+            capture->vals.push_back(copy(_env.vals[i]));
+            shadows[_env.ids[i]]++;
         }
         mem.pop_root();
-        return v;
+        return capture;
     }
 
-    static char *sub_name(cval *val) {
-        return (char*)val + sizeof(cval);
+    uint cvm::intern(const char *sym) {
+        auto f = symbol_ids.find(sym);
+        if (f != symbol_ids.end())
+            return f->second;
+        auto id = (uint) symbols.size();
+        symbol_ids.insert(std::make_pair(sym, id));
+        symbols.push_back(sym);
+        shadows.push_back(0);
+        return id;
+    }
+
+    cval *cvm::env_get(cval *env, uint id) {
+        auto &_env = *env->val._env.env;
+        if (env == global_env)
+            return id < _env.vals.size() ? _env.vals[id] : nullptr;
+        for (size_t i = 0; i < _env.ids.size(); ++i) {
+            if (_env.ids[i] == id)
+                return _env.vals[i];
+        }
+        if (_env.capture) {
+            auto &capture = *_env.capture;
+            for (size_t i = 0; i < capture.ids.size(); ++i) {
+                if (capture.ids[i] == id)
+                    return capture.vals[i];
+            }
+        }
+        return nullptr;
+    }
+
+    cval *&cvm::env_slot(cval *env, uint id) {
+        auto &_env = *env->val._env.env;
+        if (env == global_env) {
+            if (id >= _env.vals.size())
+                _env.vals.resize(symbols.size(), nullptr);
+            return _env.vals[id];
+        }
+        for (size_t i = 0; i < _env.ids.size(); ++i) {
+            if (_env.ids[i] == id)
+                return _env.vals[i];
+        }
+        _env.ids.push_back(id);
+        _env.vals.push_back(nullptr);
+        shadows[id]++;
+        return _env.vals.back();
     }
 
     uint cvm::children_size(cval *val) {
@@ -138,6 +218,8 @@ namespace clib {
                         local = local->next;
                         i = i->next;
                     }
+                    v->val._v.key = csignature::keyword(v->val._v.child);
+                    check(node, v);
                     mem.pop_root();
                     return v;
                 } else {
@@ -169,6 +251,8 @@ namespace clib {
                         local = local->next;
                         i = i->next;
                     }
+                    v->val._v.key = csignature::keyword(v->val._v.child);
+                    check(node, v);
                     mem.pop_root();
                     return v;
                 }
@@ -222,49 +306,358 @@ namespace clib {
         return nullptr;
     }
 
-    status_t cvm::call(csub fun, cval *val, cval *env, cval **ret) {
-        auto frame = eval_mem.alloc<cframe>();
-        memset(frame, 0, sizeof(cframe));
-        frame->fun = fun;
-        frame->val = val;
-        frame->env = env;
-        frame->ret = ret;
-        eval_stack.push_back(frame);
+    // 调用有签名的内建函数时，代码里直接写的选项在这里检查，出错时给出源代码中的位置
+    // 符号和S-exp要运行时才有值，留给调用时检查
+    void cvm::check(ast_node *node, cval *val) {
+        auto head = val->val._v.child;
+        if (head->type != ast_literal)
+            return;
+        auto id = symbol_ids.find(head->val._string);
+        if (id == symbol_ids.end())
+            return;
+        auto sub = env_get(global_env, id->second);
+        if (!sub || sub->type != ast_sub)
+            return;
+        auto sig = builtins::signature(sub->val._sub.sub);
+        if (!sig)
+            return;
+        string_t err;
+        auto i = node->child->next;
+        for (auto opt = head->next; opt; opt = opt->next, i = i->next) {
+            if (opt->type == ast_literal || opt->type == ast_sexpr)
+                continue;
+            if (sig->match(opt, err) < 0) {
+                char pos[32];
+                snprintf(pos, sizeof(pos), "[%04d:%03d] ", i->line, i->column);
+                error(pos + string_t(sig->name) + ": " + err);
+            }
+        }
+    }
+
+    status_t cvm::call(cval *val, cval *env, cval **ret) {
+        exec(ccompiler(this).compile(val), env, stack.size(), ret);
         return s_call;
     }
 
+    status_t cvm::tail(cval *val, cval *env) {
+        auto code = ccompiler(this).compile(val);
+        auto sp = execs.back().sp;
+        stack.resize(sp);
+        execs.pop_back();
+        exec(code, env, sp, nullptr);
+        return s_call;
+    }
+
+    void cvm::exec(ccode *code, cval *env, size_t sp, cval **ret) {
+        execs.emplace_back();
+        auto &ex = execs.back();
+        ex.code = code;
+        ex.pc = 0;
+        ex.env = env;
+        ex.sp = sp;
+        ex.ret = ret;
+        ex.frame.fun = nullptr;
+        ex.value = nullptr;
+    }
+
+    void cvm::exec_clear() {
+        for (auto &ex : execs) {
+            if (ex.code)
+                ex.code->release();
+        }
+        execs.clear();
+        stack.clear();
+    }
+
     void cvm::prepare(ast_node *node) {
         if (!root) {
             mem.save_stack();
             root = conv(node, global_env);
             ret = nullptr;
-            call(eval, root, global_env, &ret);
+            exec(ccompiler(this).compile(root), global_env, 0, &ret);
+        }
+    }
+
+    // 调用栈顶的函数，函数下面是n个参数
+    void cvm::exec_call(uint n) {
+        auto base = stack.size() - n - 1;
+        auto op = stack[base];
+        for (auto i = base; i + 1 < stack.size(); ++i)
+            stack[i]->next = stack[i + 1];
+        stack.back()->next = nullptr;
+        auto env = execs.back().env;
+        switch (op->type) {
+            case ast_sub: {
+                execs.emplace_back();
+                auto &ex = execs.back();
+                ex.code = nullptr;
+                ex.env = env;
+                ex.sp = base;
+                ex.ret = nullptr;
+                ex.result = nullptr;
+                ex.value = nullptr;
+                ex.head.type = ast_sexpr;
+                ex.head.next = nullptr;
+                ex.head.val._v.count = n + 1;
+                ex.head.val._v.child = op;
+                ex.frame.fun = op->val._sub.sub;
+                ex.frame.val = &ex.head;
+                ex.frame.env = env;
+                ex.frame.ret = &ex.result;
+                ex.frame.arg = nullptr;
+            }
+                break;
+            case ast_lambda:
+                exec_lambda(op, base, n, env);
+                break;
+            case ast_sexpr:
+            case ast_literal: {
+                // 函数求值后仍是符号或表达式，整个调用表再求值一次
+                auto v = val_obj(ast_sexpr);
+                v->val._v.count = n + 1;
+                v->val._v.child = op;
+                stack.resize(base);
+                exec(ccompiler(this).compile(v), env, base, nullptr);
+            }
+                break;
+            default:
+                error("invalid operator type for S-exp");
+        }
+    }
+
+    void cvm::exec_lambda(cval *op, size_t base, uint n, cval *env) {
+        auto _new_env = lambda_args(op, base, n, env);
+        auto code = *lambda_code(op);
+        code->retain();
+        stack.resize(base);
+        exec(code, _new_env, base, nullptr);
+    }
+
+    // 尾调用，新的运行帧替换当前帧，返回到当前帧返回的地方
+    // 当前环境的变量都被新环境的参数遮住时，新环境跳过它直接挂到上一层，尾递归只占常数空间
+    void cvm::exec_tail(uint n) {
+        auto base = stack.size() - n - 1;
+        auto op = stack[base];
+        if (op->type != ast_lambda) {
+            exec_call(n);
+            return;
+        }
+        auto &ex = execs.back();
+        auto code = *lambda_code(op);
+        auto env = ex.env;
+        if (env != global_env) {
+            auto &_env = *env->val._env.env;
+            auto hidden = !_env.capture || _env.capture == *lambda_capture(op);
+            for (auto i = _env.ids.begin(); hidden && i != _env.ids.end(); ++i) {
+                hidden = std::find(code->params.begin(), code->params.end(), *i) != code->params.end();
+            }
+            if (hidden)
+                env = env->val._env.parent;
+        }
+        auto _new_env = lambda_args(op, base, n, env);
+        code->retain();
+        auto sp = ex.sp;
+        auto _ret = ex.ret;
+        ex.code->release();
+        execs.pop_back();
+        stack.resize(sp);
+        exec(code, _new_env, sp, _ret);
+    }
+
+    // 新环境先查参数，再查捕获的变量，最后沿调用者的环境查找
+    cval *cvm::lambda_args(cval *op, size_t base, uint n, cval *env) {
+        auto code = *lambda_code(op);
+        if (n != code->params.size())
+            error("lambda need valid argument size");
+        auto _new_env = new_env(env);
+        mem.unlink(_new_env);
+        auto &_env = *_new_env->val._env.env;
+        _env.capture = *lambda_capture(op);
+        if (_env.capture)
+            _env.capture->retain();
+        mem.push_root(_new_env);
+        for (uint i = 0; i < n; ++i) {
+            auto v = copy(stack[base + 1 + i]);
+            env_slot(_new_env, code->params[i]) = v;
         }
+        _env.params = (uint) _env.ids.size();
+        mem.pop_root();
+        return _new_env;
     }
 
     cval *cvm::run(int cycle) {
-        // 自己实现调用栈
-        for (auto i = 0; !eval_stack.empty() && i < cycle; i++) {
-            auto frame = eval_stack.back();
-            auto r = frame->fun(this, frame);
-            if (r == s_ret) {
-                eval_mem.free(frame);
-                eval_stack.pop_back();
+#if VM_PROFILE
+        // 每条指令的耗时记到下一条指令开始时为止，这样break和continue都不用单独处理
+        using prof_clock = std::chrono::steady_clock;
+        auto prof_ins = -1;
+        auto prof_start = prof_clock::now();
+        auto prof_tick = [&]() {
+            auto now = prof_clock::now();
+            if (prof_ins >= 0) {
+                profile_count[prof_ins]++;
+                profile_time[prof_ins] += std::chrono::duration<double, std::nano>(now - prof_start).count();
+            }
+            prof_start = now;
+        };
+#endif
+        // 自己实现调用栈，每次执行一条指令或调用一次内建函数
+        for (auto i = 0; !execs.empty() && i < cycle; i++) {
+            auto &ex = execs.back();
+#if VM_PROFILE
+            prof_tick();
+            prof_ins = ex.code ? (int) ex.code->text[ex.pc] : i_ret + 1;
+#endif
+            if (!ex.code) {
+                if (ex.frame.fun(this, &ex.frame) == s_ret) {
+                    auto r = ex.result;
+                    stack.resize(ex.sp);
+                    execs.pop_back();
+                    stack.push_back(r);
+                }
+                continue;
+            }
+            auto &code = *ex.code;
+            auto text = code.text.data();
+            switch (text[ex.pc++]) {
+                case i_nil:
+                    stack.push_back(val_obj(ast_qexpr));
+                    break;
+                case i_const:
+                    stack.push_back(code.consts[text[ex.pc++]]);
+                    break;
+                case i_load:
+                    stack.push_back(calc_symbol(text[ex.pc++], ex.env));
+                    break;
+                case i_local:
+                    stack.push_back(copy(ex.env->val._env.env->vals[text[ex.pc++]]));
+                    break;
+                case i_capture: {
+                    auto slot = text[ex.pc++];
+                    auto id = text[ex.pc++];
+                    auto &_env = *ex.env->val._env.env;
+                    auto capture = _env.capture;
+                    if (_env.ids.size() == _env.params && capture && slot < capture->ids.size() &&
+                        capture->ids[slot] == id)
+                        stack.push_back(copy(capture->vals[slot]));
+                    else
+                        stack.push_back(calc_symbol(id, ex.env)); // 本层def了同名变量
+                }
+                    break;
+                case i_quote: {
+                    auto head = code.consts[text[ex.pc++]];
+                    auto target = text[ex.pc++];
+                    auto op = stack.back();
+                    if (op->type == ast_sub && strstr(sub_name(op), "quote")) {
+                        for (auto arg = head->next; arg; arg = arg->next)
+                            stack.push_back(arg);
+                        ex.pc = target;
+                    }
+                }
+                    break;
+                case i_call:
+                    exec_call(text[ex.pc++]);
+                    break;
+                case i_tail:
+                    exec_tail(text[ex.pc++]);
+                    break;
+                case i_calc:
+                case i_test: {
+                    auto ins = text[ex.pc - 1];
+                    auto op = (int) text[ex.pc++];
+                    auto id = text[ex.pc++];
+                    auto x = text[ex.pc++];
+                    auto y = text[ex.pc++];
+                    auto sp = stack.size() - ((x & 3) == 0) - ((y & 3) == 0);
+                    auto top = sp;
+                    auto a = operand(x, code, ex.env, top);
+                    auto b = operand(y, code, ex.env, top);
+                    if (!calc_native(op, id)) {
+                        // 运算符被重新定义了，按普通调用处理，参数同i_local和i_load要拷贝
+                        if ((x & 3) >= 2)
+                            a = copy(a);
+                        if ((y & 3) >= 2)
+                            b = copy(b);
+                        stack.resize(sp);
+                        stack.push_back(calc_symbol(id, ex.env));
+                        stack.push_back(a);
+                        stack.push_back(b);
+                        exec_call(2); // i_test的结果返回后由后面的i_jf处理
+                        break;
+                    }
+                    if (ins == i_calc) {
+                        auto r = calc_bin(op, a, b, ex.env);
+                        stack.resize(sp);
+                        stack.push_back(r);
+                    } else {
+                        auto flag = calc_test(op, a, b, ex.env);
+                        stack.resize(sp);
+                        ex.pc = flag ? ex.pc + 2 : text[ex.pc + 1];
+                    }
+                }
+                    break;
+                case i_native: {
+                    auto op = (int) text[ex.pc++];
+                    auto id = text[ex.pc++];
+                    auto target = text[ex.pc++];
+                    if (calc_native(op, id))
+                        ex.pc = target;
+                    i--; // 只是检查，不算一条指令，脚本每个时间片的进度不变
+                }
+                    break;
+                case i_lambda: {
+                    auto child = code.children[text[ex.pc++]];
+                    child->retain();
+                    stack.push_back(val_lambda(child, new_capture(ex.env)));
+                }
+                    break;
+                case i_jmp:
+                    ex.pc = text[ex.pc];
+                    break;
+                case i_jf: {
+                    auto target = text[ex.pc++];
+                    auto cond = stack.back();
+                    stack.pop_back();
+                    if (cond->type == ast_int && cond->val._int == 0)
+                        ex.pc = target;
+                }
+                    break;
+                case i_pop:
+                    stack.pop_back();
+                    break;
+                case i_ret: {
+                    auto r = stack.back();
+                    stack.resize(ex.sp);
+                    auto _ret = ex.ret;
+                    ex.code->release();
+                    execs.pop_back();
+                    if (_ret) {
+                        *_ret = r;
+                        if (!execs.empty())
+                            execs.back().value = r;
+                    } else {
+                        stack.push_back(r);
+                    }
+                }
+                    break;
+                default:
+                    error("invalid instruction");
             }
         }
+#if VM_PROFILE
+        prof_tick();
+#endif
         if (ret == nullptr)
             return nullptr;
         assert(ret);
         root = nullptr;
-        eval_stack.clear();
-        eval_mem.clear();
+        exec_clear();
         eval_tmp.clear();
         return ret;
     }
 
     void cvm::error(const string_t &info) {
         printf("COMPILER ERROR: %s\n", info.c_str());
-        throw std::exception();
+        throw std::runtime_error(info);
     }
 
     void cvm::print(cval *val, std::ostream &os) {
@@ -372,6 +765,88 @@ namespace clib {
 #endif
     }
 
+    bool cvm::gc_step(size_t budget) {
+        return mem.gc_step(budget, execs.empty());
+    }
+
+    size_t cvm::count() const {
+        return mem.count();
+    }
+
+    void cvm::trace(std::function<void(void *, size_t)> callback) {
+        mem.set_trace_callback(callback);
+    }
+
+#if VM_PROFILE
+    void cvm::profile(std::ostream *os) {
+        if (!os) {
+            std::fill(std::begin(profile_count), std::end(profile_count), 0);
+            std::fill(std::begin(profile_time), std::end(profile_time), 0.0);
+            return;
+        }
+        static const char *names[] = {
+            "nil", "const", "load", "local", "capture", "quote", "call", "tail",
+            "calc", "test", "native", "lambda", "jmp", "jf", "pop", "ret", "<builtin>",
+        };
+        // 计时本身的开销，每条指令都要扣掉
+        using prof_clock = std::chrono::steady_clock;
+        const auto n = 100000;
+        auto start = prof_clock::now();
+        for (auto i = 0; i < n; i++)
+            prof_clock::now();
+        auto overhead = std::chrono::duration<double, std::nano>(prof_clock::now() - start).count() / n;
+        size_t count = 0;
+        auto total = 0.0;
+        for (auto i = 0; i <= i_ret + 1; i++) {
+            profile_time[i] = std::max(0.0, profile_time[i] - overhead * profile_count[i]);
+            count += profile_count[i];
+            total += profile_time[i];
+        }
+        auto flags = os->flags();
+        auto precision = os->precision();
+        *os << std::fixed << std::setprecision(1);
+        *os << "instruction      count  count%   time ms   time%  ns/ins  (timer " << overhead << " ns removed)"
+            << std::endl;
+        for (auto i = 0; i <= i_ret + 1; i++) {
+            if (profile_count[i] == 0)
+                continue;
+            *os << std::left << std::setw(10) << names[i] << std::right
+                << std::setw(12) << profile_count[i]
+                << std::setw(7) << 100.0 * profile_count[i] / count << "%"
+                << std::setw(10) << std::setprecision(3) << profile_time[i] * 1e-6 << std::setprecision(1)
+                << std::setw(7) << (total > 0 ? 100.0 * profile_time[i] / total : 0.0) << "%"
+                << std::setw(8) << profile_time[i] / profile_count[i] << std::endl;
+            profile_count[i] = 0;
+            profile_time[i] = 0;
+        }
+        *os << std::left << std::setw(10) << "total" << std::right << std::setw(12) << count
+            << std::setw(18) << std::setprecision(3) << total * 1e-6 << std::endl;
+        os->flags(flags);
+        os->precision(precision);
+    }
+#endif
+
+    // 运行中的对象可能已脱离结点树（如lambda的新环境），由虚拟机标记
+    void cvm::mark_roots() {
+        if (execs.empty())
+            return;
+        mem.shade(root);
+        mem.shade(ret);
+        for (auto &v : stack) {
+            mem.shade(v);
+        }
+        cval *below = nullptr;
+        for (auto &ex : execs) {
+            // 父环境可能属于已出栈的lambda，只有这里引用它
+            // 环境沿调用者连接，走到下一层运行帧的环境就停，它的环境链刚刚标记过，否则递归深时是平方的
+            for (auto env = ex.env; env && env != below; env = env->val._env.parent) {
+                mem.shade(env);
+            }
+            below = ex.env;
+            mem.shade(ex.value);
+        }
+    }
+
     cval *cvm::copy(cval *val) {
         cval *new_val{nullptr};
         switch (val->type) {
@@ -379,8 +854,14 @@ namespace clib {
             case ast_env:
                 error("not supported");
                 break;
-            case ast_lambda:
-                new_val = val_lambda(val->val._lambda.param, val->val._lambda.body, *lambda_env(val));
+            case ast_lambda: {
+                auto code = *lambda_code(val);
+                auto capture = *lambda_capture(val);
+                code->retain();
+                if (capture)
+                    capture->retain();
+                new_val = val_lambda(code, capture);
+            }
                 break;
             case ast_sub:
                 new_val = val_sub(val);
@@ -390,6 +871,7 @@ namespace clib {
             case ast_qexpr:
                 new_val = val_obj(val->type);
                 new_val->val._v.count = val->val._v.count;
+                new_val->val._v.key = val->val._v.key;
                 if (new_val->val._v.count > 0) {
                     mem.push_root(new_val);
                     auto head = val->val._v.child;
@@ -434,30 +916,48 @@ namespace clib {
         return new_val;
     }
 
-    cval *cvm::calc_symbol(const char *sym, cval *env) {
+    cval *cvm::calc_symbol(uint id, cval *env) {
+        return copy(lookup(id, env));
+    }
+
+    cval *cvm::lookup(uint id, cval *env) {
+        if (shadows[id] == 0)
+            env = global_env; // 没有局部变量同名，直接查全局环境
         while (env) {
-            auto &_env = *env->val._env.env;
-            auto f = _env.find(sym);
-            if (f != _env.end()) {
-                return copy(f->second);
-            }
+            auto v = env_get(env, id);
+            if (v)
+                return v;
             env = env->val._env.parent;
         }
-        printf("invalid symbol: %s\n", sym);
+        printf("invalid symbol: %s\n", symbols[id].c_str());
         error("cannot find symbol");
         return nullptr;
     }
 
+    // 二元运算的操作数，见ccompiler::operand，栈上的从top开始依次取
+    cval *cvm::operand(uint x, const ccode &code, cval *env, size_t &top) {
+        switch (x & 3) {
+            case 0:
+                return stack[top++];
+            case 1:
+                return code.consts[x >> 2];
+            case 2:
+                return env->val._env.env->vals[x >> 2];
+            default:
+                return lookup(x >> 2, env);
+        }
+    }
+
     cval *cvm::new_env(cval *env) {
         auto _env = val_obj(ast_env);
-        _env->val._env.env = new cval::cenv_t();
+        _env->val._env.env = new cenv();
         _env->val._env.parent = env;
         return _env;
     }
 
     void cvm::set_free_callback() {
 #if SHOW_ALLOCATE_NODE
-        mem.set_callback([](void *ptr) {
+        mem.set_callback([this](void *ptr) {
             cval *val = (cval *) ptr;
             printf("[DEBUG] GC    | free: 0x%p, node: %-10s, ", ptr, cast::ast_str(val->type).c_str());
             if (val->type == ast_sexpr || val->type == ast_qexpr) {
@@ -465,8 +965,11 @@ namespace clib {
             } else if (val->type == ast_literal) {
                 printf("id: %s\n", val->val._string);
             } else if (val->type == ast_env) {
-                printf("env: %d\n", val->val._env.env->size());
-                delete val->val._env.env;
+                printf("env: %lu\n", val->val._env.env->vals.size());
+                free_env(val);
+            } else if (val->type == ast_lambda) {
+                printf("lambda\n");
+                free_lambda(val);
             } else if (val->type == ast_sub) {
                 printf("name: %s\n", sub_name(val));
             } else {
@@ -485,7 +988,7 @@ namespace clib {
             } else if (val->type == ast_literal) {
                 printf("id: %s\n", val->val._string);
             } else if (val->type == ast_env) {
-                printf("env: %d\n", val->val._env.env->size());
+                printf("env: %lu\n", val->val._env.env->vals.size());
             } else if (val->type == ast_sub) {
                 printf("name: %s\n", sub_name(val));
             } else {
@@ -495,23 +998,41 @@ namespace clib {
             }
         });
 #else
-        mem.set_callback([](void *ptr) {
+        mem.set_callback([this](void *ptr) {
             cval *val = (cval *) ptr;
             if (val->type == ast_env) {
-                delete val->val._env.env;
+                free_env(val);
+            } else if (val->type == ast_lambda) {
+                free_lambda(val);
             }
         });
 #endif
     }
 
+    void cvm::free_env(cval *env) {
+        auto _env = env->val._env.env;
+        for (auto &id : _env->ids)
+            shadows[id]--;
+        if (_env->capture)
+            _env->capture->release();
+        delete _env;
+    }
+
+    void cvm::free_lambda(cval *val) {
+        (*lambda_code(val))->release();
+        auto capture = *lambda_capture(val);
+        if (capture)
+            capture->release();
+    }
+
     void cvm::save() {
         mem.save_stack();
     }
 
     void cvm::restore() {
+        root = nullptr;
         mem.restore_stack();
-        eval_stack.clear();
-        eval_mem.clear();
+        exec_clear();
         eval_tmp.clear();
     }
 
@@ -523,9 +1044,9 @@ namespace clib {
 
     void cvm::reset() {
         global_env = nullptr;
+        root = nullptr;
+        exec_clear();
         mem.clear();
-        eval_stack.clear();
-        eval_mem.clear();
         eval_tmp.clear();
         builtin();
     }
@@ -6,19 +6,26 @@
 #ifndef CLIBLISP_CVM_H
 #define CLIBLISP_CVM_H
 
-#define VM_MEM (32 * 1024)
-#define VM_EVAL (32 * 1024)
-#define VM_TMP (32 * 1024)
+#define VM_MEM (4 * 1024) // 内存池第一段的块数，不够时自动增长
+#define VM_TMP (1 * 1024)
 #define SHOW_ALLOCATE_NODE 0
+#ifndef VM_PROFILE
+#define VM_PROFILE 0 // 1为统计每种指令的次数和耗时（每条指令都要计时，有开销），可在编译选项中指定
+#endif
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include "cast.h"
 #include "memory_gc.h"
+#include "ccompiler.h"
 
 namespace clib {
 
     class cvm;
     struct cframe;
+    struct cval;
+    struct ccapture;
 
     enum status_t {
         s_ret,
@@ -28,19 +35,41 @@ namespace clib {
 
     using ctmp = void *;
 
+    // 环境中的变量，按符号编号查找
+    // 全局环境直接用编号作下标，ids不用；lambda调用时的环境变量很少，顺序查找，参数排在最前面
+    struct cenv {
+        std::vector<uint> ids; // 符号编号
+        std::vector<cval *> vals; // 值
+        ccapture *capture{nullptr}; // lambda捕获的变量，在本层变量之后、上层环境之前查找
+        uint params{0}; // 参数个数，之后的变量是def定义的
+    };
+
+    // lambda创建时捕获所在环境本层的变量，之后不再修改，lambda的副本和调用时的环境共享同一份，用引用计数管理
+    // 变量的值挂在anchor下，anchor受GC保护，引用计数为零时才解除保护
+    struct ccapture {
+        std::vector<uint> ids;
+        std::vector<cval *> vals;
+        cval *anchor{nullptr};
+        cvm *vm{nullptr};
+        int ref{1};
+
+        void retain();
+        void release();
+    };
+
     struct cval {
-        using cenv_t = std::unordered_map<std::string, cval *>;
         using csub_t = status_t (*)(cvm *vm, cframe *frame);
         ast_t type;
         cval *next;
         union {
             struct {
                 uint count;
+                uint key; // 作为内建函数的选项时，选项名的关键字编号，0表示还没解析
                 cval *child;
             } _v;
             struct {
                 cval *parent;
-                cenv_t *env;
+                cenv *env;
             } _env;
             struct {
                 void *vm;
@@ -66,15 +95,30 @@ namespace clib {
         } val;
     };
 
-    using cenv = cval::cenv_t;
     using csub = cval::csub_t;
 
+    // 内建函数的调用参数
+    // val是调用表，第一个孩子是函数，后面是参数；返回s_call时用cvm::call求值，求值完成后会再次调用
     struct cframe {
         csub fun;
         cval *val, *env, **ret;
         void *arg;
     };
 
+    // 运行帧，code为空时是内建函数
+    // 运行帧存在deque中，地址不变，内建函数可以把返回值位置指向自己的帧
+    struct cexec {
+        ccode *code; // 字节码
+        uint pc; // 指令位置
+        cval *env; // 环境
+        size_t sp; // 操作数栈的基址
+        cval **ret; // 返回值写到这里，为空时压入操作数栈
+        cframe frame; // 内建函数的调用参数
+        cval head; // 内建函数的调用表（不经过GC）
+        cval *result; // 内建函数的返回值
+        cval *value; // 内建函数用cvm::call求得的值，GC时作为根
+    };
+
     class cvm {
     public:
         cvm();
@@ -84,10 +128,19 @@ namespace clib {
         cvm &operator=(const cvm &) = delete;
 
         friend class builtins;
+        friend class ccompiler;
+        friend struct ccode;
+        friend struct ccapture;
 
         void prepare(ast_node *node);
         cval *run(int cycle);
         void gc();
+        bool gc_step(size_t budget); // 增量回收，可以穿插在run之间，返回true表示回收完毕
+        size_t count() const; // 存活的对象数
+        void trace(std::function<void(void *, size_t)> callback); // 记录内存池的分配和释放
+#if VM_PROFILE
+        void profile(std::ostream *os); // 输出并清空每种指令的次数和耗时，os为空时只清空
+#endif
 
         static void print(cval *val, std::ostream &os);
 
@@ -104,40 +157,65 @@ namespace clib {
         void builtin_init();
         void builtin_load();
         cval *conv(ast_node *node, cval *env);
+        void check(ast_node *node, cval *val); // 检查内建函数的选项
+
+        status_t call(cval *val, cval *env, cval **ret); // 内建函数中求值val，结果写到ret
+        status_t tail(cval *val, cval *env); // 内建函数中求值val作为自己的返回值，替换掉内建函数的运行帧
 
-        status_t call(csub fun, cval *val, cval *env, cval **ret);
+        void exec(ccode *code, cval *env, size_t sp, cval **ret);
+        void exec_call(uint n);
+        void exec_tail(uint n);
+        void exec_lambda(cval *op, size_t base, uint n, cval *env);
+        cval *lambda_args(cval *op, size_t base, uint n, cval *env);
+        void exec_clear();
 
         int calc(int op, ast_t type, cval *r, cval *v, cval *env);
         cval *calc_op(int op, cval *val, cval *env);
-        cval *calc_symbol(const char *sym, cval *env);
+        cval *calc_symbol(uint id, cval *env);
+        bool calc_native(int op, uint id); // 符号仍绑定着运算符或特殊形式原来的内建函数
+        cval *calc_bin(int op, cval *a, cval *b, cval *env); // 二元运算，不修改操作数
+        bool calc_test(int op, cval *a, cval *b, cval *env); // 二元运算结果的真假
+        cval *operand(uint x, const ccode &code, cval *env, size_t &top);
         cval *calc_sub(const char *sub, cval *val, cval *env);
 
-        static status_t eval(cvm *vm, cframe *frame);
-        static status_t eval_one(cvm *vm, cframe *frame);
-        static status_t eval_child(cvm *vm, cframe *frame);
-
         cval *val_obj(ast_t type);
         cval *val_str(ast_t type, const char *str);
         cval *val_sub(const char *name, csub sub);
         cval *val_sub(cval *val);
         cval *val_bool(bool flag);
-        cval *val_lambda(cval *param, cval *body, cval *env);
+        cval *val_lambda(ccode *code, ccapture *capture);
 
         cval *copy(cval *val);
         cval *new_env(cval *env);
+        ccapture *new_capture(cval *env);
+
+        uint intern(const char *sym); // 符号的编号
+        cval *env_get(cval *env, uint id); // 只查这一层（包括捕获的变量），没有时返回空
+        cval *lookup(uint id, cval *env); // 沿环境链查找符号，返回原值
+        cval *&env_slot(cval *env, uint id); // 本层变量的位置，没有时新建
 
         static uint children_size(cval *val);
 
         void set_free_callback();
+        void free_env(cval *env);
+        void free_lambda(cval *val);
+        void mark_roots();
 
     private:
         cval *global_env{nullptr};
         memory_pool_gc<VM_MEM> mem;
-        std::vector<cframe *> eval_stack;
-        memory_pool<VM_EVAL> eval_mem;
+        std::deque<cexec> execs; // 运行帧
+        std::vector<cval *> stack; // 操作数栈
         memory_pool<VM_TMP> eval_tmp;
         cval *root{nullptr};
         cval *ret{nullptr};
+        std::unordered_map<std::string, uint> symbol_ids; // 符号表
+        std::vector<std::string> symbols;
+        std::vector<uint> shadows; // 符号在全局以外的环境中绑定的次数，为零时直接查全局环境
+#if VM_PROFILE
+        size_t profile_count[i_ret + 2]{}; // 最后一项是内建函数的运行帧
+        double profile_time[i_ret + 2]{}; // 纳秒
+#endif
     };
 }
 
@@ -4,38 +4,39 @@
 //
 
 #include <GL/freeglut.h>
+#include <cstring>
+#include <fstream>
 #include "c2dworld.h"
+#include "c2draster.h"
+#include "c2dsim.h"
 
 using namespace clib;
 
-static auto &last_clock = c2d_world::last_clock;
-static auto &dt =  c2d_world::dt;
-static auto &dt_inv =  c2d_world::dt_inv;
-static auto &paused = c2d_world::paused;
 static auto &title = c2d_world::title;
+static c2d_render_batch batch; // 每帧的绘制批次（无窗口模式）
+static c2d_simulator *sim = nullptr; // 模拟线程
+static auto last_clock = std::chrono::high_resolution_clock::now();
+static decimal render_fps = 0; // 绘制帧率
 
-// 每步操作
-static void c2d_step() {
+// 绘制模拟线程发布的最新快照
+static const c2d_snapshot &c2d_draw() {
     glMatrixMode(GL_MODELVIEW); // 转换视图开始绘制
     glLoadIdentity();
     glTranslatef(0.0f, 0.0f, -10.0f);
 
-    world->step();
+    auto &snapshot = sim->snapshot();
+    c2d_render_gl(snapshot.batch);
+    return snapshot;
 }
 
 // 移动（调试）
 void c2d_move(const v2 &v) {
-    world->move(v);
+    world->post(c2d_command::move(v));
 }
 
 // 旋转（调试）
 void c2d_rotate(decimal d) {
-    world->rotate(d);
-}
-
-// 拖动（调试）
-void c2d_offset(const v2 &pt, const v2 &offset) {
-    world->offset(pt, offset);
+    world->post(c2d_command::rotate(d));
 }
 
 /**
@@ -80,17 +81,21 @@ void display() {
     int h = glutGet(GLUT_WINDOW_HEIGHT); // 窗口的高
     int w = glutGet(GLUT_WINDOW_WIDTH); // 窗口的宽
 
-    c2d_step(); // 坐标轴同直角坐标系
+    auto &snapshot = c2d_draw(); // 坐标轴同直角坐标系
 
     // 绘制文字
     draw_text(10, 20, "clib-2d @bajdcc"); // 暂不支持中文
-    draw_text(w - 110, 20, "FPS: %.1f", dt_inv);
+    draw_text(w - 110, 20, "FPS: %.1f", render_fps);
+    draw_text(w - 110, 50, "SIM: %.1f", snapshot.fps);
     draw_text(10, h - 20, "#c4p2");
-    draw_text(w - 290, h - 20, "Collisions: %d, Zombie: %d", world->get_collision_size(), world->get_sleeping_size());
-    if (paused)
+    draw_text(w - 290, h - 20, "Collisions: %d, Zombie: %d", snapshot.collisions, snapshot.sleeping);
+#if ENABLE_ALLOC_COUNT
+    draw_text(w - 290, h - 50, "Alloc: %d", (int) snapshot.alloc);
+#endif
+    if (snapshot.paused)
         draw_text(w / 2 - 30, 20, "PAUSED");
 
-    draw_text(w / 2 - 200, (glutGet(GLUT_SCREEN_WIDTH) < 1920) ? 60 : 80, title.c_str());
+    draw_text(w / 2 - 200, (glutGet(GLUT_SCREEN_WIDTH) < 1920) ? 60 : 80, snapshot.title.c_str());
 
     glutSwapBuffers(); // 切换双缓冲
 }
@@ -104,14 +109,15 @@ void reshape(int width, int height) {
 
 void keyboard(unsigned char key, int x, int y) {
     if (key >= '0' && key <= '9') {
-        world->scene(key - '0');
+        auto id = key - '0';
+        world->post(c2d_command::scene(id));
     } else {
         switch (key) {
             case 27:
                 glutLeaveMainLoop(); // 按ESC退出
                 break;
             case ' ':
-                paused = !paused;
+                world->post(c2d_command::call([](c2d_world *) { c2d_world::paused = !c2d_world::paused; }));
                 break;
             case 'w':
                 c2d_move(v2(0, 0.1));
@@ -132,7 +138,7 @@ void keyboard(unsigned char key, int x, int y) {
                 c2d_rotate(-0.1);
                 break;
             case 'g':
-                world->invert_gravity();
+                world->post(c2d_command::invert_gravity());
                 break;
             default:
                 break;
@@ -162,32 +168,498 @@ v2 screen2world(int x, int y) {
 
 void mouse(int button, int state, int x, int y) {
     if (button == GLUT_LEFT_BUTTON) {
-        world->mouse(screen2world(x, y), state == GLUT_DOWN);
+        auto pt = screen2world(x, y);
+        auto down = state == GLUT_DOWN;
+        world->post(c2d_command::mouse(pt, down));
     }
 }
 
 void motion(int x, int y) {
-    world->motion(screen2world(x, y));
+    auto pt = screen2world(x, y);
+    world->post(c2d_command::motion(pt));
 }
 
 void idle() {
     auto now = std::chrono::high_resolution_clock::now();
     // 计算每帧时间间隔
-    dt = std::chrono::duration_cast<std::chrono::duration<double>>(now - last_clock).count();
+    auto dt = std::chrono::duration_cast<std::chrono::duration<double>>(now - last_clock).count();
 
-    // 锁帧
+    // 锁帧，模拟在单独的线程中进行，这里只负责绘制
     if (dt > FRAME_SPAN) {
-        dt_inv = 1.0 / dt;
+        render_fps = 1.0 / dt;
         last_clock = now;
         display();
     }
 }
 
 void entry(int state) {
-    paused = state == GLUT_LEFT;
+    auto paused = state == GLUT_LEFT;
+    world->post(c2d_command::pause(paused));
+}
+
+// 用软件光栅化渲染场景的每一步，画面留在raster中，返回每步的平均绘制耗时
+static double render_scene(int id, int steps, c2d_raster &raster) {
+    c2d_world::seed = 1; // 固定随机种子，保证每次结果一致
+    world = new c2d_world();
+    world->scene(id);
+    auto render_time = 0.0;
+    for (auto i = 0; i < steps; ++i) {
+        world->step();
+        auto start = std::chrono::high_resolution_clock::now();
+        batch.clear();
+        world->draw(batch);
+        raster.clear();
+        raster.render(batch);
+        render_time += std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+    }
+    delete world;
+    world = nullptr;
+    return steps ? render_time / steps : 0.0;
+}
+
+// 无窗口模式：用软件光栅化渲染每一步，输出最后一帧，可与参考图逐像素比较
+// 用法：--headless 场景 步数 输出前缀 [参考图前缀]
+// 输出 前缀.png 和 前缀.ppm；给出参考图时读取 参考图前缀.ppm，有差异则返回1
+static int headless(int argc, char *argv[]) {
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s --headless <scene> <steps> <prefix> [reference_prefix]\n", argv[0]);
+        return 2;
+    }
+    auto id = atoi(argv[2]);
+    auto steps = atoi(argv[3]);
+    std::string prefix = argv[4];
+    c2d_raster raster(800, 600);
+    auto ms = render_scene(id, steps, raster);
+    printf("%s: %d steps, render %.3f ms/step\n", title.c_str(), steps, ms);
+    auto ret = 0;
+    if (!raster.write_png(prefix + ".png") || !raster.write_ppm(prefix + ".ppm")) {
+        fprintf(stderr, "cannot write %s\n", prefix.c_str());
+        ret = 2;
+    } else if (argc > 5) {
+        c2d_raster reference(1, 1);
+        if (!reference.read_ppm(std::string(argv[5]) + ".ppm")) {
+            fprintf(stderr, "cannot read %s.ppm\n", argv[5]);
+            ret = 2;
+        } else {
+            auto diff = c2d_raster::diff(raster, reference);
+            printf("diff: %zu pixels\n", diff);
+            ret = diff > 0 ? 1 : 0;
+        }
+    }
+    return ret;
+}
+
+// 画面回归测试：场景跑给定的步数，最后一帧与 目录/scene_场景.ppm 比较
+// 用法：--regression 目录 场景 步数 [--update]，--update时重新生成参考图
+// 不同编译器的浮点结果在最后几位上会有出入，容差：任一通道相差超过24算不同，不同的像素不超过1%；否则返回1
+// 混乱的场景（如圆的金字塔倒塌）误差放大得快，步数要取短一些
+static int regression(int argc, char *argv[]) {
+    const auto width = 200, height = 150, tolerance = 24;
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s --regression <dir> <scene> <steps> [--update]\n", argv[0]);
+        return 2;
+    }
+    auto id = atoi(argv[3]);
+    auto steps = atoi(argv[4]);
+    auto file = std::string(argv[2]) + "/scene_" + std::to_string(id) + ".ppm";
+    c2d_raster raster(width, height);
+    render_scene(id, steps, raster);
+    if (argc > 5 && strcmp(argv[5], "--update") == 0) {
+        if (!raster.write_ppm(file)) {
+            fprintf(stderr, "cannot write %s\n", file.c_str());
+            return 2;
+        }
+        printf("%s: updated %s\n", title.c_str(), file.c_str());
+        return 0;
+    }
+    c2d_raster reference(1, 1);
+    if (!reference.read_ppm(file)) {
+        fprintf(stderr, "cannot read %s\n", file.c_str());
+        return 2;
+    }
+    auto diff = c2d_raster::diff(raster, reference, tolerance);
+    auto limit = (size_t) width * height / 100;
+    printf("%s: %zu pixels differ (limit %zu)\n", title.c_str(), diff, limit);
+    return diff > limit ? 1 : 0;
+}
+
+// 精度测试：场景跑给定的步数，与 目录/trace_场景.txt 中双精度算出的物体位置、角度和机械能比较
+// 用法：--precision 目录 场景 步数 [--update]，--update时用当前精度重新生成（应在双精度下生成）
+// 单精度的舍入误差大得多，容差按decimal的类型取；超出容差返回1
+static int precision(int argc, char *argv[]) {
+#if USE_FLOAT
+    const double pos_tolerance = 1e-3, angle_tolerance = 5e-2, energy_tolerance = 1e-3;
+#else
+    const double pos_tolerance = 1e-6, angle_tolerance = 1e-6, energy_tolerance = 1e-6;
+#endif
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s --precision <dir> <scene> <steps> [--update]\n", argv[0]);
+        return 2;
+    }
+    auto id = atoi(argv[3]);
+    auto steps = atoi(argv[4]);
+    auto file = std::string(argv[2]) + "/trace_" + std::to_string(id) + ".txt";
+    c2d_world::seed = 1;
+    world = new c2d_world();
+    world->scene(id);
+    for (auto i = 0; i < steps; ++i)
+        world->step();
+    // 第一行为机械能，之后每行一个物体：x y 角度
+    std::vector<double> state{(double) world->get_energy()};
+    for (auto body : world->get_bodies()) {
+        state.push_back(body->pos.x);
+        state.push_back(body->pos.y);
+        state.push_back(body->angle);
+    }
+    delete world;
+    world = nullptr;
+    if (argc > 5 && strcmp(argv[5], "--update") == 0) {
+        auto f = fopen(file.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", file.c_str());
+            return 2;
+        }
+        fprintf(f, "%.17g\n", state[0]);
+        for (size_t i = 1; i < state.size(); i += 3)
+            fprintf(f, "%.17g %.17g %.17g\n", state[i], state[i + 1], state[i + 2]);
+        fclose(f);
+        printf("%s: updated %s\n", title.c_str(), file.c_str());
+        return 0;
+    }
+    std::ifstream ifs(file);
+    std::vector<double> reference;
+    double d;
+    while (ifs >> d)
+        reference.push_back(d);
+    if (reference.size() != state.size()) {
+        fprintf(stderr, "%s: expect %zu values, got %zu\n", file.c_str(), state.size(), reference.size());
+        return 2;
+    }
+    auto energy = std::abs(state[0] - reference[0]) / std::max(1.0, std::abs(reference[0]));
+    auto pos = 0.0, angle = 0.0;
+    for (size_t i = 1; i < state.size(); i += 3) {
+        pos = std::max(pos, std::max(std::abs(state[i] - reference[i]), std::abs(state[i + 1] - reference[i + 1])));
+        angle = std::max(angle, std::abs(state[i + 2] - reference[i + 2]));
+    }
+    auto ok = pos <= pos_tolerance && angle <= angle_tolerance && energy <= energy_tolerance;
+    printf("%s (%s): position %.3g (%.0e), angle %.3g (%.0e), energy %.3g (%.0e) %s\n", title.c_str(),
+           USE_FLOAT ? "float" : "double", pos, pos_tolerance, angle, angle_tolerance, energy, energy_tolerance,
+           ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+// 性能测试：只计算物理，不绘制
+// 用法：--bench 场景 步数
+// 先跑与碰撞计算相同的向量运算作为微基准，再给出每步物理计算的平均耗时
+static int bench(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s --bench <scene> <steps>\n", argv[0]);
+        return 2;
+    }
+    auto id = atoi(argv[2]);
+    auto steps = atoi(argv[3]);
+    using clock = std::chrono::high_resolution_clock;
+
+    // 微基准：collision_update中的相对速度、法向冲量和切向冲量
+    {
+        const auto n = 1024, loops = 2000;
+        std::vector<v2> ra(n), rb(n), va(n), vb(n);
+        std::vector<decimal> wa(n), wb(n), pn(n), pt(n);
+        for (auto i = 0; i < n; ++i) {
+            ra[i] = v2(i % 7 * 0.1, i % 5 * 0.1);
+            rb[i] = v2(i % 3 * 0.1, i % 11 * 0.1);
+            va[i] = v2(0, -1);
+            wa[i] = i % 13 * 0.01;
+        }
+        const auto N = v2(0, 1), T = N.normal();
+        auto start = clock::now();
+        for (auto k = 0; k < loops; ++k) {
+            for (auto i = 0; i < n; ++i) {
+                auto dv = (vb[i] + wb[i] * rb[i].N()) - (va[i] + wa[i] * ra[i].N());
+                auto _pn = std::max<decimal>(pn[i] - dv.dot(N), 0);
+                auto dpn = _pn - pn[i];
+                pn[i] = _pn;
+                auto dpt = -dv.dot(T);
+                pt[i] += dpt;
+                auto p = (dpn * N + dpt * T) * 0.5;
+                va[i] -= p;
+                wa[i] -= ra[i].cross(p);
+                vb[i] += p;
+                wb[i] += rb[i].cross(p);
+            }
+        }
+        auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (loops * n);
+        auto sum = 0.0;
+        for (auto i = 0; i < n; ++i)
+            sum += pn[i] + pt[i];
+        printf("contact math: %.2f ns/contact (checksum %g)\n", ns, sum);
+    }
+
+    c2d_world::seed = 1; // 固定随机种子，保证每次结果一致
+    world = new c2d_world();
+    world->scene(id);
+    auto start = clock::now();
+    for (auto i = 0; i < steps; ++i) {
+        world->step();
+    }
+    auto ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    printf("%s: %d steps, physics %.3f ms/step, collisions %zu, sleeping %zu\n", title.c_str(), steps,
+           steps ? ms / steps : 0.0, world->get_collision_size(), world->get_sleeping_size());
+#if ENABLE_ALLOC_COUNT
+    printf("heap allocations in the last step: %zu\n", world->get_alloc_size());
+#endif
+    delete world;
+    return 0;
+}
+
+// 回收压力测试：反复用cons递归建表再回收，表长翻倍直到最长表长
+// 用法：--gc-bench [轮数] [最长表长]
+// 建表时每执行LISP_CYCLE条指令做一次增量回收，给出建表过程中存活对象数的峰值（应与表长成正比），
+// 单次增量回收的最长停顿和建表后完整回收的停顿
+static int gc_bench(int argc, char *argv[]) {
+    auto rounds = argc > 2 ? atoi(argv[2]) : 3;
+    auto max_len = argc > 3 ? atoi(argv[3]) : 100000;
+    using clock = std::chrono::high_resolution_clock;
+    world = new c2d_world();
+    cvm vm;
+    auto eval = [&](const std::string &code) -> cval * {
+        cparser p(code);
+        vm.prepare(p.parse());
+        cval *val;
+        while (!(val = vm.run(LISP_CYCLE)))
+            vm.gc_step(LISP_GC_STEP);
+        return val;
+    };
+    eval(R"(def `range (\ `(a b) `(if (== a b) `nil `(cons a (range (+ a 1) b)))))");
+    vm.gc();
+    for (auto n = std::min(10, max_len);; n = std::min(n * 2, max_len)) {
+        auto code = "def `xs (range 0 " + std::to_string(n) + ")";
+        auto step_max = 0.0, step_sum = 0.0, full_max = 0.0, total = 0.0;
+        size_t steps = 0, peak = 0, alive = 0;
+        for (auto r = 0; r < rounds; ++r) {
+            cparser p(code);
+            auto start = clock::now();
+            vm.prepare(p.parse());
+            while (!vm.run(LISP_CYCLE)) {
+                auto t = clock::now();
+                vm.gc_step(LISP_GC_STEP);
+                auto ms = std::chrono::duration<double, std::milli>(clock::now() - t).count();
+                step_max = std::max(step_max, ms);
+                step_sum += ms;
+                steps++;
+                peak = std::max(peak, vm.count());
+            }
+            auto t = clock::now();
+            vm.gc(); // 上一轮的表已被def替换，连同临时对象一起回收
+            auto end = clock::now();
+            full_max = std::max(full_max, std::chrono::duration<double, std::milli>(end - t).count());
+            total += std::chrono::duration<double, std::milli>(end - start).count();
+            alive = vm.count();
+        }
+        printf("list %6d: peak %7zu objects (%.1f per element), alive %zu, %.3f ms/round, "
+               "step %.4f ms avg %.4f ms max (%zu steps), full gc %.3f ms max\n", n, peak, (double) peak / n, alive,
+               total / rounds, steps ? step_sum / steps : 0.0, step_max, steps / rounds, full_max);
+        if (n == max_len)
+            break;
+    }
+    delete world;
+    return 0;
+}
+
+// 回放分配记录，trace中size为0的是释放，arg为第几次分配；返回每次操作的纳秒数
+template<class Pool>
+static double alloc_replay(const std::vector<std::pair<size_t, size_t>> &trace, size_t allocs, int rounds,
+                           size_t &failed) {
+    using clock = std::chrono::high_resolution_clock;
+    std::vector<char *> ptrs(allocs);
+    auto ns = 0.0;
+    failed = 0;
+    for (auto r = 0; r < rounds; ++r) {
+        auto pool = new Pool();
+        size_t id = 0;
+        auto start = clock::now();
+        for (auto &t : trace) {
+            if (t.first) {
+                auto p = pool->template alloc_array<char>((uint) t.first);
+                if (p)
+                    memset(p, 0, t.first);
+                else
+                    failed++;
+                ptrs[id++] = p;
+            } else if (ptrs[t.second]) {
+                pool->free_array(ptrs[t.second]);
+            }
+        }
+        ns += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        delete pool;
+    }
+    return ns / rounds / trace.size();
+}
+
+// 分配器测试：记录虚拟机建表、递归和回收时内存池的实际分配序列，分别在两种内存池上回放
+// 用法：--alloc-bench [轮数]
+static int alloc_bench(int argc, char *argv[]) {
+    auto rounds = argc > 2 ? atoi(argv[2]) : 20;
+    world = new c2d_world();
+    std::vector<std::pair<size_t, size_t>> trace;
+    std::unordered_map<void *, size_t> ids;
+    {
+        cvm vm;
+        vm.trace([&](void *ptr, size_t size) {
+            if (size) {
+                ids[ptr] = trace.size();
+                trace.emplace_back(size, 0);
+            } else {
+                auto it = ids.find(ptr);
+                if (it == ids.end())
+                    return;
+                trace.emplace_back(0, it->second);
+                ids.erase(it);
+            }
+        });
+        auto eval = [&](const std::string &code) {
+            cparser p(code);
+            vm.prepare(p.parse());
+            while (!vm.run(LISP_CYCLE))
+                vm.gc_step(LISP_GC_STEP);
+            vm.gc();
+        };
+        eval(R"(def `range (\ `(a b) `(if (== a b) `nil `(cons a (range (+ a 1) b)))))");
+        eval(R"(def `fib (\ `n `(if (< n 2) `n `(+ (fib (- n 1)) (fib (- n 2))))))");
+        for (auto r = 0; r < 4; ++r) {
+            for (auto n = 10; n <= 80; n *= 2)
+                eval("def `xs (range 0 " + std::to_string(n) + ")");
+            eval("fib 10");
+        }
+    }
+    delete world;
+    // 分配记录中的序号换成第几次分配
+    size_t allocs = 0;
+    std::vector<size_t> order(trace.size());
+    for (size_t i = 0; i < trace.size(); ++i) {
+        if (trace[i].first)
+            order[i] = allocs++;
+        else
+            trace[i].second = order[trace[i].second];
+    }
+    size_t failed;
+    auto first_fit = alloc_replay<first_fit_memory_pool<32 * 1024>>(trace, allocs, rounds, failed); // 不能增长，按原来的大小
+    printf("first-fit:  %.1f ns/op, failed %zu\n", first_fit, failed);
+    auto segregated = alloc_replay<memory_pool<VM_MEM>>(trace, allocs, rounds, failed);
+    printf("segregated: %.1f ns/op, failed %zu\n", segregated, failed);
+    printf("%zu allocs, %zu frees, %d rounds\n", allocs, trace.size() - allocs, rounds);
+    return 0;
+}
+
+// 批量创建测试：逐个创建、批量创建和脚本中用boxes各创建n个矩形，给出创建耗时和之后第一步物理计算的耗时
+// 用法：--spawn-bench [个数]
+static int spawn_bench(int argc, char *argv[]) {
+    auto n = argc > 2 ? atoi(argv[2]) : 10000;
+    using clock = std::chrono::high_resolution_clock;
+    std::vector<decimal> mass(n, 1);
+    std::vector<v2> size(n, v2(0.4, 0.4)), pos(n);
+    for (auto i = 0; i < n; ++i)
+        pos[i] = v2(i % 100 * 0.5, i / 100 * 0.5); // 排成网格，互不重叠
+    auto run = [&](const char *name, const std::function<void()> &spawn) {
+        world = new c2d_world();
+        auto start = clock::now();
+        spawn();
+        auto t = clock::now();
+        world->step();
+        auto end = clock::now();
+        printf("%-6s: %d bodies, spawn %.3f ms, first step %.3f ms\n", name, n,
+               std::chrono::duration<double, std::milli>(t - start).count(),
+               std::chrono::duration<double, std::milli>(end - t).count());
+        delete world;
+    };
+    run("single", [&] {
+        for (auto i = 0; i < n; ++i)
+            world->make_rect(mass[i], size[i].x, size[i].y, pos[i]);
+    });
+    run("bulk", [&] {
+        world->make_rects(mass.data(), size.data(), pos.data(), nullptr, (size_t) n);
+    });
+    // 坐标表直接写在代码里，不把建表的时间算进来，只测boxes本身
+    std::string xs;
+    for (auto i = 0; i < n; ++i)
+        xs += std::to_string(i % 100 * 0.5) + "d ";
+    std::string ys;
+    for (auto i = 0; i < n; ++i)
+        ys += std::to_string(i / 100 * 0.5) + "d ";
+    cvm vm;
+    cparser p("boxes (list `pos `(" + xs + ") `(" + ys + ")) `(size 0.4d 0.4d)");
+    auto root = p.parse();
+    run("script", [&] {
+        vm.prepare(root);
+        while (!vm.run(INT32_MAX));
+    });
+    return 0;
+}
+
+// 脚本测试：反复运行几段脚本，给出每次运行和回收的平均耗时
+// 用法：--lisp-bench [次数]
+// 以VM_PROFILE=1编译时再按指令给出次数和耗时
+static int lisp_bench(int argc, char *argv[]) {
+    auto rounds = argc > 2 ? atoi(argv[2]) : 100;
+    using clock = std::chrono::high_resolution_clock;
+    world = new c2d_world();
+    cvm vm;
+    auto eval = [&](const char *code) {
+        cparser p(code);
+        vm.prepare(p.parse());
+        cval *val;
+        while (!(val = vm.run(INT32_MAX)));
+        return val;
+    };
+    eval(R"(def `fib (\ `n `(if (< n 2) `n `(+ (fib (- n 1)) (fib (- n 2))))))");
+    eval(R"(def `sum (\ `n `(begin (def `s 0) (while `(> n 0) `(begin (def `s (+ s (* n n))) (def `n (- n 1)))) s)))");
+    vm.gc();
+#if VM_PROFILE
+    vm.profile(nullptr); // 只统计下面的脚本
+#endif
+    const char *codes[] = {
+            "fib 15",
+            "sum 1000",
+            "len (map (\\ `x `(* x x)) (range 0 100))",
+    };
+    for (auto code : codes) {
+        auto run = 0.0, gc = 0.0;
+        for (auto r = 0; r < rounds; ++r) {
+            auto start = clock::now();
+            eval(code);
+            auto t = clock::now();
+            vm.gc();
+            auto end = clock::now();
+            run += std::chrono::duration<double, std::milli>(t - start).count();
+            gc += std::chrono::duration<double, std::milli>(end - t).count();
+        }
+        printf("%-40s run %.3f ms, gc %.3f ms\n", code, run / rounds, gc / rounds);
+    }
+#if VM_PROFILE
+    vm.profile(&std::cout);
+#endif
+    delete world;
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+        return headless(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--regression") == 0)
+        return regression(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--precision") == 0)
+        return precision(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return bench(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--gc-bench") == 0)
+        return gc_bench(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--alloc-bench") == 0)
+        return alloc_bench(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--spawn-bench") == 0)
+        return spawn_bench(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--lisp-bench") == 0)
+        return lisp_bench(argc, argv);
     glutInit(&argc, argv);
     if (glutGet(GLUT_SCREEN_WIDTH) < 1920) {
         glutInitWindowSize(800, 600);
@@ -200,6 +672,8 @@ int main(int argc, char *argv[]) {
     glutCreateWindow("Physics Engine -- bajdcc");
     world = new c2d_world();
     world->init(); // 初始化
+    sim = new c2d_simulator(world);
+    sim->start(); // 启动模拟线程
     glutDisplayFunc(&idle); // 绘制
     glutReshapeFunc(&reshape); // 窗口大小改变事件
     glutMouseFunc(&mouse); // 鼠标点击事件
@@ -209,6 +683,8 @@ int main(int argc, char *argv[]) {
     glutEntryFunc(&entry); // 没有事件输入时调用，这里不用它
     glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_CONTINUE_EXECUTION);
     glutMainLoop(); // 主事件循环
+    sim->stop();
+    delete sim;
     delete world;
     return 0;
 }
\ No newline at end of file
@@ -7,7 +7,10 @@
 #define CLIBLISP_MEMORY_H
 
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iterator>
 #include <vector>
 #include "types.h"
 
@@ -67,6 +70,7 @@ namespace clib {
         enum block_flag {
             BLOCK_USING = 0,
             BLOCK_MARK = 1,
+            BLOCK_TEMP = 2,
         };
 
         // 块的元信息部分的大小
@@ -177,8 +181,6 @@ namespace clib {
             size = block_align(size);
             if (size >= block_available_size)
                 return nullptr;
-            if (block_current == block_head)
-                return alloc_free_block(size);
             auto blk = block_current;
             do {
                 if (block_get_flag(blk, BLOCK_USING) == 0 && blk->size >= size) {
@@ -194,12 +196,12 @@ namespace clib {
         void *alloc_free_block(size_t size) {
             if (block_current->size == size) // 申请的大小正好是空闲块大小
             {
-                return alloc_cur_block(size + 1);
+                return alloc_cur_block(size);
             }
             // 申请的空间小于空闲块大小，将空闲块分裂
             auto new_size = block_current->size - size - 1;
             if (new_size == 0)
-                return alloc_cur_block(size); // 分裂后的新块空间过低，放弃分裂
+                return alloc_cur_block(size + 1); // 分裂后的新块空间过低，放弃分裂，整块分配
             block *new_blk = block_current + size + 1;
             block_init(new_blk, new_size);
             block_connect(block_current, new_blk);
@@ -248,10 +250,12 @@ namespace clib {
                     block_set_flag(blk, BLOCK_USING, 0);
                     break;
                 case 2:
+                    if (block_current == blk) // 当前块被合并进前一块
+                        block_current = blk->prev;
                     block_available_size += block_merge(blk->prev, blk, false);
                     break;
                 case 3:
-                    if (block_current == blk->next)
+                    if (block_current == blk || block_current == blk->next)
                         block_current = blk->prev;
                     block_available_size += block_merge(blk->prev, blk, blk->next);
                     break;
@@ -419,8 +423,376 @@ namespace clib {
         }
     };
 
+    // 分级空闲链表内存池
+    // 按数据部分的块数分级，每级一条空闲链表，小对象的分配和释放都是O(1)，不合并相邻块
+    // 块头的大小和标记位与legacy_memory_pool相同，GC照常可用
+    // 内存不够时再申请一段，每段是上一段的两倍，空出来的段可用release归还（第一段保留）
+    template<class Allocator, size_t DefaultSize = Allocator::DEFAULT_ALLOC_BLOCK_SIZE>
+    class segregated_memory_pool {
+        struct chunk;
+
+    public:
+        // 块
+        struct block {
+            size_t size; // 数据部分的大小
+            uint flag;   // 参数
+            chunk *owner; // 所在的段
+            block *next;  // 空闲链表的后指针
+        };
+
+        // 块参数
+        enum block_flag {
+            BLOCK_USING = 0,
+            BLOCK_MARK = 1,
+            BLOCK_TEMP = 2,
+        };
+
+        // 块的元信息部分的大小
+        static const size_t BLOCK_SIZE = sizeof(block);
+        // 块大小掩码
+        static const uint BLOCK_SIZE_MASK = BLOCK_SIZE - 1;
+        // 小对象的级数，更大的块放在大块链表中首次适配
+        static const size_t CLASS_SIZE = 32;
+
+    private:
+        // 段
+        struct chunk {
+            block *head; // 起始
+            block *end;  // 末尾
+            size_t used; // 正在使用的块个数
+            bool spare;  // 上次release时已经空了
+        };
+
+        // 内存管理接口
+        Allocator allocator;
+        // 所有段，最后一段是最新申请的
+        std::vector<chunk *> chunks;
+        // 最新一段中尚未切分过的内存
+        block *block_top{nullptr};
+        // 各级空闲链表，free_list[n]中的块数据部分为n块
+        block *free_list[CLASS_SIZE + 1];
+        // 大块空闲链表
+        block *large_list{nullptr};
+        // 空闲块数
+        size_t block_available_size{0};
+        // 没有块在使用的段数（不算第一段）
+        size_t empty_chunks{0};
+
+        // ------------------------ //
+
+        // 块大小对齐
+        static size_t block_align(size_t size) {
+            if ((size & BLOCK_SIZE_MASK) == 0)
+                return size / BLOCK_SIZE;
+            return (size / BLOCK_SIZE) + 1;
+        }
+
+        static void block_set_flag(block *blk, block_flag flag, uint value) {
+            if (value) {
+                blk->flag |= 1 << flag;
+            } else {
+                blk->flag &= ~(1 << flag);
+            }
+        }
+
+        static uint block_get_flag(block *blk, block_flag flag) {
+            return (blk->flag & (1 << flag)) != 0 ? 1 : 0;
+        }
+
+        // ------------------------ //
+
+        void _create() {
+            std::fill(std::begin(free_list), std::end(free_list), nullptr);
+            grow(DEFAULT_ALLOC_BLOCK_SIZE);
+        }
+
+        void _init() {
+            while (chunks.size() > 1) {
+                allocator.__free_array(chunks.back()->head);
+                delete chunks.back();
+                chunks.pop_back();
+            }
+            auto c = chunks.front();
+            c->used = 0;
+            block_top = c->head;
+            std::fill(std::begin(free_list), std::end(free_list), nullptr);
+            large_list = nullptr;
+            block_available_size = c->end - c->head;
+            empty_chunks = 0;
+        }
+
+        void _destroy() {
+            for (auto c : chunks) {
+                allocator.__free_array(c->head);
+                delete c;
+            }
+            chunks.clear();
+        }
+
+        // 申请新的一段，不小于上一段的两倍
+        void grow(size_t size) {
+            if (!chunks.empty()) {
+                auto last = chunks.back();
+                size = std::max(size, (size_t) (last->end - last->head) * 2);
+                // 上一段剩下的内存放进空闲链表
+                if (last->end - block_top >= 2) {
+                    block_top->size = last->end - block_top - 1;
+                    block_top->owner = last;
+                    push_free(block_top);
+                } else {
+                    block_available_size -= last->end - block_top;
+                    last->end = block_top;
+                }
+            }
+            auto head = allocator.template __alloc_array<block>((uint) size);
+            assert(head);
+            chunks.push_back(new chunk{head, head + size, 0, false});
+            block_top = head;
+            block_available_size += size;
+        }
+
+        // 放回空闲链表
+        void push_free(block *blk) {
+            blk->flag = 0;
+            auto &list = blk->size <= CLASS_SIZE ? free_list[blk->size] : large_list;
+            blk->next = list;
+            list = blk;
+        }
+
+        // 使用块
+        void *use_block(block *blk) {
+            blk->flag = 0;
+            block_set_flag(blk, BLOCK_USING, 1);
+            blk->next = nullptr;
+            block_available_size -= blk->size + 1;
+            return static_cast<void *>(blk + 1);
+        }
+
+        // 申请内存
+        void *_alloc(size_t size) {
+            if (size == 0)
+                return nullptr;
+            size = block_align(size);
+            auto blk = take_block(size);
+            if (!blk) {
+                grow(size + 1);
+                blk = take_block(size);
+            }
+            auto c = blk->owner;
+            if (c->used++ == 0 && c != chunks.front()) {
+                c->spare = false;
+                empty_chunks--;
+            }
+            return use_block(blk);
+        }
+
+        // 从空闲链表或未切分的内存中取出数据部分不小于size块的块，不够时返回nullptr
+        block *take_block(size_t size) {
+            if (size <= CLASS_SIZE && free_list[size]) {
+                auto blk = free_list[size];
+                free_list[size] = blk->next;
+                return blk;
+            }
+            if (block_top + size + 1 <= chunks.back()->end) {
+                auto blk = block_top;
+                blk->size = size;
+                blk->owner = chunks.back();
+                block_top += size + 1;
+                return blk;
+            }
+            // 未切分的内存用完了，从更大的空闲块中切分
+            for (auto i = size + 2; i <= CLASS_SIZE; ++i) {
+                if (free_list[i]) {
+                    auto blk = free_list[i];
+                    free_list[i] = blk->next;
+                    split(blk, size);
+                    return blk;
+                }
+            }
+            for (auto prev = &large_list; *prev; prev = &(*prev)->next) {
+                if ((*prev)->size >= size) {
+                    auto blk = *prev;
+                    *prev = blk->next;
+                    split(blk, size);
+                    return blk;
+                }
+            }
+            return nullptr;
+        }
+
+        // 空闲块blk只留size块，多出的部分放回空闲链表，放不下块头时整块分配
+        void split(block *blk, size_t size) {
+            if (blk->size > size + 1) {
+                auto rest = blk + size + 1;
+                rest->size = blk->size - size - 1;
+                rest->owner = blk->owner;
+                push_free(rest);
+                blk->size = size;
+            }
+        }
+
+        // 释放内存
+        bool _free(void *p) {
+            auto blk = static_cast<block *>(p);
+            --blk; // 自减得到块的元信息头
+            if (block_get_flag(blk, BLOCK_USING) == 0)
+                return false;
+            auto c = blk->owner;
+            block_available_size += blk->size + 1;
+            push_free(blk);
+            if (--c->used == 0 && c != chunks.front())
+                empty_chunks++;
+            return true;
+        }
+
+        // 重新分配内存
+        void *_realloc(void *p, uint newSize, uint clsSize) {
+            auto blk = static_cast<block *>(p);
+            --blk;
+            auto oldSize = blk->size;
+            auto _new = _alloc(newSize * clsSize);
+            if (!_new) {
+                _free(p);
+                return nullptr;
+            }
+            memmove(_new, p, sizeof(block) * std::min(oldSize, block_align(newSize * clsSize)));
+            _free(p);
+            return _new;
+        }
+
+        // 从链表中摘除落在空段中的块
+        void remove_empty(block *&list) {
+            auto prev = &list;
+            while (*prev) {
+                auto c = (*prev)->owner;
+                if (c->used == 0 && c->spare && c != chunks.front())
+                    *prev = (*prev)->next;
+                else
+                    prev = &(*prev)->next;
+            }
+        }
+
+    public:
+        // 第一段的块数
+        static const size_t DEFAULT_ALLOC_BLOCK_SIZE = DefaultSize;
+        // 第一段的内存总量
+        static const size_t DEFAULT_ALLOC_MEMORY_SIZE = BLOCK_SIZE * DEFAULT_ALLOC_BLOCK_SIZE;
+
+        segregated_memory_pool() {
+            _create();
+        }
+
+        ~segregated_memory_pool() {
+            _destroy();
+        }
+
+        template<class T>
+        T *alloc() {
+            return static_cast<T *>(_alloc(sizeof(T)));
+        }
+
+        template<class T>
+        T *alloc_array(uint count) {
+            return static_cast<T *>(_alloc(count * sizeof(T)));
+        }
+
+        template<class T, class ...TArgs>
+        T *alloc_args(const TArgs &&... args) {
+            T *obj = static_cast<T *>(_alloc(sizeof(T)));
+            (*obj)(std::forward(args)...);
+            return obj;
+        }
+
+        template<class T, class ...TArgs>
+        T *alloc_array_args(uint count, const TArgs &&... args) {
+            T *obj = static_cast<T *>(_alloc(count * sizeof(T)));
+            for (uint i = 0; i < count; ++i) {
+                (obj[i])(std::forward(args)...);
+            }
+            return obj;
+        }
+
+        template<class T>
+        T *realloc(T *obj, uint newSize) {
+            return static_cast<T *>(_realloc(obj, newSize, sizeof(T)));
+        }
+
+        template<class T>
+        bool free(T *obj) {
+            return _free(obj);
+        }
+
+        template<class T>
+        bool free_array(T *obj) {
+            return _free(obj);
+        }
+
+        size_t available() const {
+            return block_available_size;
+        }
+
+        // 归还连续两次release时都没有块在使用的段（第一段除外），返回归还的段数
+        // 只空了一次的段先留着，反复运行同样的脚本时不用来回申请
+        size_t release() {
+            if (empty_chunks == 0)
+                return 0;
+            size_t n = 0;
+            for (auto it = chunks.begin() + 1; it != chunks.end(); ++it) {
+                if ((*it)->used == 0 && (*it)->spare)
+                    n++;
+            }
+            if (n > 0) {
+                for (auto &list : free_list)
+                    remove_empty(list);
+                remove_empty(large_list);
+                auto top_released = chunks.back()->used == 0 && chunks.back()->spare;
+                for (auto it = chunks.begin() + 1; it != chunks.end();) {
+                    auto c = *it;
+                    if (c->used == 0 && c->spare) {
+                        block_available_size -= c->end - c->head;
+                        allocator.__free_array(c->head);
+                        delete c;
+                        it = chunks.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                if (top_released)
+                    block_top = chunks.back()->end; // 之前的段都已切分完
+                empty_chunks -= n;
+            }
+            for (auto it = chunks.begin() + 1; it != chunks.end(); ++it) {
+                if ((*it)->used == 0)
+                    (*it)->spare = true;
+            }
+            return n;
+        }
+
+        void clear() {
+            _init();
+        }
+
+        void dump(std::ostream &os) {
+            printf("[DEBUG] MEM   | Available: %lu, Untouched: %lu, Chunks: %lu\n", block_available_size,
+                   (size_t) (chunks.back()->end - block_top), chunks.size());
+            for (size_t i = 1; i <= CLASS_SIZE; ++i) {
+                size_t n = 0;
+                for (auto blk = free_list[i]; blk; blk = blk->next)
+                    n++;
+                if (n > 0)
+                    printf("[DEBUG] MEM   | Class %2lu: %lu free\n", i, n);
+            }
+            for (auto blk = large_list; blk; blk = blk->next)
+                printf("[DEBUG] MEM   | [%p-%p] Size: %8lu, State: Free\n", blk, blk + blk->size, blk->size);
+        }
+    };
+
+    // 首次适配的内存池（原实现）
+    template<size_t DefaultSize = default_allocator<>::DEFAULT_ALLOC_BLOCK_SIZE>
+    using first_fit_memory_pool = legacy_memory_pool<legacy_memory_pool_allocator<default_allocator<>, DefaultSize>>;
+
     template<size_t DefaultSize = default_allocator<>::DEFAULT_ALLOC_BLOCK_SIZE>
-    using memory_pool = legacy_memory_pool<legacy_memory_pool_allocator<default_allocator<>, DefaultSize>>;
+    using memory_pool = segregated_memory_pool<default_allocator<DefaultSize>>;
 }
 
 #endif //CLIBLISP_MEMORY_H
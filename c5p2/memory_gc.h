@@ -9,14 +9,23 @@
 #include <functional>
 #include <unordered_set>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include "memory.h"
 #include "types.h"
 
 #define SHOW_GC 1
+#define GC_ALLOC_WORK 4 // 每分配一个对象欠下的回收工作量
 
 namespace clib {
 
+    // 三色标记的增量回收
+    // 白色：未标记；灰色：已标记，在gray中等待扫描子结点；黑色：已标记且扫描完毕
+    // 标记期间新分配的对象直接为黑色，link时父结点已标记则把子结点染灰（写屏障）
+    // 标记结束前重新扫描一次根，补上这期间只被栈或虚拟机引用的对象
+    // 分配时记下欠的工作量，下一次增量回收一并补上，回收的速度跟得上分配，堆的大小与存活对象成正比
+    // 直接挂在栈底的是临时对象，只被虚拟机的操作数栈引用，可以就地修改而不用拷贝
     template<size_t DefaultSize = default_allocator<>::DEFAULT_ALLOC_BLOCK_SIZE>
     class legacy_memory_gc {
     public:
@@ -29,9 +38,16 @@ namespace clib {
         using memory_pool_t = memory_pool<DefaultSize>;
         using blk_t = typename memory_pool_t::block;
         static const auto BLOCK_MARK = memory_pool_t::BLOCK_MARK;
+        static const auto BLOCK_TEMP = memory_pool_t::BLOCK_TEMP;
         static const auto GC_HEADER_SIZE = sizeof(gc_header);
         static const auto GC_BLOCK_SIZE = sizeof(blk_t);
 
+        enum gc_phase_t {
+            gc_idle,
+            gc_mark,
+            gc_sweep,
+        };
+
         legacy_memory_gc() {
             stack_roots.push_back(&stack_head);
         }
@@ -62,6 +78,20 @@ namespace clib {
             return (blk->flag & (1 << BLOCK_MARK)) != 0 ? 1 : 0;
         }
 
+        static void set_temp(void *ptr, bool value) {
+            auto blk = block(ptr);
+            if (value) {
+                blk->flag |= 1 << BLOCK_TEMP;
+            } else {
+                blk->flag &= ~(1 << BLOCK_TEMP);
+            }
+        }
+
+        static uint is_temp(void *ptr) {
+            auto blk = block(ptr);
+            return (blk->flag & (1 << BLOCK_TEMP)) != 0 ? 1 : 0;
+        }
+
         template<class T>
         T *alloc() {
             return static_cast<T *>(alloc(sizeof(T)));
@@ -71,6 +101,8 @@ namespace clib {
             auto new_node = static_cast<gc_header *>((void *) memory.template alloc_array<char>(GC_HEADER_SIZE + size));
             assert(new_node);
             memset(new_node, 0, GC_HEADER_SIZE + size);
+            if (phase != gc_idle)
+                set_marked(new_node, true); // 回收期间分配的对象本轮存活
             auto &top = stack_roots.back();
             if (top->child) {
                 new_node->prev = top->child->prev;
@@ -81,7 +113,12 @@ namespace clib {
                 top->child = new_node;
                 new_node->next = new_node->prev = new_node;
             }
+            if (top == &stack_head)
+                set_temp(new_node, true);
             objects.push_back(new_node);
+            debt += GC_ALLOC_WORK;
+            if (trace_callback)
+                trace_callback(new_node, GC_HEADER_SIZE + size);
             return (void *) (static_cast<char *>((void *) new_node) + GC_HEADER_SIZE);
         }
 
@@ -109,6 +146,12 @@ namespace clib {
             auto _parent = stack_roots.back();
             auto _ptr = header(ptr);
             _unlink(_parent, _ptr);
+            set_temp(_ptr, false);
+        }
+
+        // 是否是栈底的临时对象
+        bool temporary(void *ptr) const {
+            return is_temp(header(ptr)) != 0;
         }
 
         void protect(void *ptr) {
@@ -116,12 +159,34 @@ namespace clib {
         }
 
         void unprotect(void *ptr) {
-            roots.erase(ptr);
+            roots.erase(header(ptr));
         }
 
+        // 完整回收，只能在虚拟机空闲时调用，临时对象全部回收
         void gc() {
-            mark();
-            sweep();
+            while (phase != gc_idle)
+                step(SIZE_MAX, true);
+            step(SIZE_MAX, true);
+            debt = 0;
+        }
+
+        // 增量回收，最多做budget个单位的工作（扫描或清除一个对象为一个单位），另加上次以来分配欠下的工作量
+        // idle表示虚拟机空闲，此时开始的一轮回收不再把临时对象作为根
+        // 返回true表示完成了一轮空闲时开始的回收
+        bool gc_step(size_t budget, bool idle) {
+            budget = budget > SIZE_MAX - debt ? SIZE_MAX : budget + debt;
+            debt = 0;
+            return step(budget, idle);
+        }
+
+        bool collecting() const {
+            return phase != gc_idle;
+        }
+
+        // 把对象染灰，供根回调标记栈上的对象
+        void shade(void *ptr) {
+            if (ptr)
+                _shade(header(ptr));
         }
 
         size_t count() const {
@@ -136,6 +201,16 @@ namespace clib {
             dump_callback = callback;
         }
 
+        // 标记开始和结束时调用，用shade标记不在结点树上的根
+        void set_root_callback(std::function<void()> callback) {
+            root_callback = callback;
+        }
+
+        // 记录内存池的分配（size为申请的字节数）和释放（size为0），用于回放测试分配器
+        void set_trace_callback(std::function<void(void *, size_t)> callback) {
+            trace_callback = callback;
+        }
+
         void save_stack() {
             saved_stack = stack_roots.size();
         }
@@ -154,6 +229,11 @@ namespace clib {
                 gc_callback(data(obj));
             }
             objects.clear();
+            roots.clear();
+            gray.clear();
+            phase = gc_idle;
+            debt = 0;
+            sweep_read = sweep_write = 0;
             stack_roots.clear();
             stack_roots.push_back(&stack_head);
             memory.clear();
@@ -162,21 +242,56 @@ namespace clib {
         }
 
     private:
-        void mark_children(gc_header *ptr) {
+        void _shade(gc_header *ptr) {
+            if (!is_marked(ptr)) {
+                set_marked(ptr, true);
+                gray.push_back(ptr);
+            }
+        }
+
+        // 扫描一个灰色对象的子结点，返回工作量
+        size_t scan(gc_header *ptr) {
+            size_t work = 1;
             if (ptr->child) {
                 auto i = ptr->child;
-                set_marked(i, true);
-                mark_children(i);
-                i = i->next;
-                while (i != ptr->child) {
-                    set_marked(i, true);
-                    mark_children(i);
+                do {
+                    _shade(i);
                     i = i->next;
+                    work++;
+                } while (i != ptr->child);
+            }
+            return work;
+        }
+
+        bool step(size_t budget, bool idle) {
+            if (phase == gc_idle)
+                mark_roots(idle);
+            size_t work = 0;
+            while (phase == gc_mark && work < budget) {
+                if (gray.empty()) {
+                    remark();
+                    if (gray.empty()) {
+                        if (!full)
+                            prune();
+                        phase = gc_sweep;
+                        sweep_read = sweep_write = 0;
+                    }
+                    continue;
                 }
+                auto ptr = gray.back();
+                gray.pop_back();
+                work += scan(ptr);
             }
+            while (phase == gc_sweep && work < budget) {
+                work += sweep(budget - work);
+            }
+            return phase == gc_idle && full;
         }
 
         void _link(gc_header *parent, gc_header *ptr) {
+            if (phase == gc_mark && is_marked(parent))
+                _shade(ptr); // 写屏障：黑色结点不能直接指向白色结点
+            set_temp(ptr, false);
             if (parent->child) {
                 ptr->prev = parent->child->prev;
                 ptr->prev->next = ptr;
@@ -195,6 +310,11 @@ namespace clib {
                     parent->child = nullptr;
                     return;
                 }
+                if (i->prev == ptr) { // 刚分配的结点在链表末尾，直接摘除
+                    ptr->prev->next = i;
+                    i->prev = ptr->prev;
+                    return;
+                }
                 if (i == ptr) {
                     parent->child = i->next;
                     i->prev->next = parent->child;
@@ -218,45 +338,97 @@ namespace clib {
             }
         }
 
-        void mark() {
-            stack_roots.front()->child = nullptr;
+        // 开始一轮标记
+        // 空闲时栈底的临时对象全部丢弃；运行中由根回调标记还在用的，其余在标记结束时摘除
+        void mark_roots(bool idle) {
+            phase = gc_mark;
+            full = idle;
+            if (idle)
+                stack_head.child = nullptr;
+            remark();
+        }
+
+        // 从栈底的链表中摘除未标记的临时对象
+        void prune() {
+            auto head = stack_head.child;
+            if (!head)
+                return;
+            gc_header *first = nullptr, *last = nullptr;
+            auto i = head;
+            do {
+                auto next = i->next;
+                if (is_marked(i)) {
+                    if (first) {
+                        last->next = i;
+                        i->prev = last;
+                    } else {
+                        first = i;
+                    }
+                    last = i;
+                }
+                i = next;
+            } while (i != head);
+            if (first) {
+                last->next = first;
+                first->prev = last;
+            }
+            stack_head.child = first;
+        }
+
+        // 标记根，本轮中会调用多次，已标记的根不再重复扫描
+        void remark() {
             for (auto &root : roots) {
-                set_marked(root, true);
-                mark_children(root);
+                _shade(root);
             }
             for (auto it = stack_roots.begin() + 1; it != stack_roots.end(); it++) {
-                auto &root = *it;
-                set_marked(root, true);
-                mark_children(root);
+                _shade(*it);
             }
+            root_callback();
         }
 
-        void sweep() {
-            for (auto it = objects.begin(); it != objects.end();) {
-                auto &obj = *it;
+        // 原地压缩objects，存活对象前移，返回工作量
+        size_t sweep(size_t budget) {
+            size_t work = 0;
+            while (sweep_read < objects.size() && work < budget) {
+                auto obj = objects[sweep_read++];
+                work++;
                 if (is_marked(obj)) {
                     set_marked(obj, false);
-                    it++;
+                    objects[sweep_write++] = obj;
                 } else {
 #if SHOW_GC
                     if (gc_callback)
                         gc_callback((void *) data((void *) obj));
 #endif
+                    if (trace_callback)
+                        trace_callback(obj, 0);
                     memory.free(obj);
-                    it = objects.erase(it);
                 }
             }
+            if (sweep_read == objects.size()) {
+                objects.resize(sweep_write);
+                phase = gc_idle;
+                if (full)
+                    memory.release(); // 空闲时的一轮回收结束，归还空出来的内存段
+            }
+            return work;
         }
 
+        // 先序输出，用显式栈代替递归，子结点逆序入栈以保持原来的顺序
         void dump_children(gc_header *ptr, int level) {
-            dump_callback(data(ptr), level);
-            if (ptr->child) {
-                auto i = ptr->child;
-                dump_children(i, level + 1);
-                i = i->next;
-                while (i != ptr->child) {
-                    dump_children(i, level + 1);
-                    i = i->next;
+            std::vector<std::pair<gc_header *, int>> st;
+            st.emplace_back(ptr, level);
+            while (!st.empty()) {
+                auto top = st.back();
+                st.pop_back();
+                dump_callback(data(top.first), top.second);
+                auto child = top.first->child;
+                if (child) {
+                    auto i = child->prev;
+                    do {
+                        st.emplace_back(i, top.second + 1);
+                        i = i->prev;
+                    } while (i != child->prev);
                 }
             }
         }
@@ -278,7 +450,14 @@ namespace clib {
         gc_header stack_head{nullptr, nullptr, nullptr};
         std::function<void(void *)> gc_callback{[](void *) {}};
         std::function<void(void *, int)> dump_callback{[](void *, int) {}};
+        std::function<void()> root_callback{[]() {}};
+        std::function<void(void *, size_t)> trace_callback;
         std::vector<gc_header *> objects;
+        std::vector<gc_header *> gray; // 灰色对象
+        gc_phase_t phase{gc_idle};
+        bool full{false}; // 本轮是否在空闲时开始
+        size_t debt{0}; // 上次增量回收以来分配欠下的工作量
+        size_t sweep_read{0}, sweep_write{0}; // 清除进度
         std::vector<gc_header *> stack_roots;
         std::unordered_set<gc_header *> roots;
         memory_pool <DefaultSize> memory;
@@ -0,0 +1,234 @@
+//
+// Project: cliblisp
+// Created by bajdcc
+//
+
+#include <iostream>
+#include <sstream>
+#include <tuple>
+#include "cparser.h"
+#include "cvm.h"
+#include "c2dworld.h"
+
+#define TEST(a,b) std::make_tuple(a, b)
+#define TEST_MEM(a,b,c) std::make_tuple(a, b, c)
+
+// 出错的用例，结果写成"ERROR: "加错误信息
+#define ERR(msg) "ERROR: " msg
+
+int main() {
+    clib::world = new clib::c2d_world();
+    clib::cvm vm;
+    auto codes = std::vector<std::tuple<std::string, std::string>>{
+            TEST("+ 1 2", "3"),
+            TEST("* 1 2 3 4 5 6", "720"),
+            TEST("- 8 4 2 9 8 ", "-15"),
+            TEST(R"(+ "Hello" " " "world!")", R"("Hello world!")"),
+            TEST("eval 5", "5"),
+            TEST("eval `(+ 1 2)", "3"),
+            TEST("eval (+ 1 2)", "3"),
+            TEST("`a", "`a"),
+            TEST("`(a b c)", "`(a b c)"),
+            TEST(R"(+ "Project: " __project__ ", author: " __author__)", R"("Project: cliblisp, author: bajdcc")"),
+            TEST("+", R"(<subroutine "+">)"),
+            // tests for lis.py
+            TEST(R"(quote (testing 1 2.0 -3.14e159))", "`(testing 1 2 -3.14e+159)"),
+            TEST(R"(+ 2 2)", "4"),
+            TEST(R"(+ (* 2 100) (* 1 10))", "210"),
+            TEST(R"(if (> 6 5) `(+ 1 1) `(+ 2 2))", "2"),
+            TEST(R"(if (< 6 5) `(+ 1 1) `(+ 2 2))", "4"),
+            TEST(R"(def `x 3)", "3"),
+            TEST(R"(x)", "3"),
+            TEST(R"(+ x x)", "6"),
+            TEST(R"(begin (def `x 1) (def `x (+ x 1)) (+ x 1))", "3"),
+            TEST(R"((\ `(x) `(+ x x)) 5)", "10"),
+            TEST(R"(def `twice (\ `(x) `(* 2 x)))", R"(<lambda `x `(* 2 x)>)"),
+            TEST(R"(twice 5)", "10"),
+            TEST(R"(def `compose (\ `(f g) `(\ `(x) `(f (g x)))))", R"(<lambda `(f g) `(\ `x `(f (g x)))>)"),
+            TEST(R"((compose list twice) 5)", "`10"),
+            TEST(R"(def `repeat (\ `(f) `(compose f f)))", "<lambda `f `(compose f f)>"),
+            TEST(R"((repeat twice) 5)", "20"),
+            TEST(R"((repeat (repeat twice)) 5)", "80"),
+            TEST(R"(def `fact (\ `(n) `(if (<= n 1) `1 `(* n (fact (- n 1))))))",
+                 R"(<lambda `n `(if (<= n 1) `1 `(* n (fact (- n 1))))>)"),
+            TEST(R"(fact 3)", "6"),
+            // 整数是32位的，c5p1中的fact 50要大整数才能算出，没有移植
+            TEST(R"(fact 12)", "479001600"),
+            TEST(R"(def `abs (\ `(n) `((if (> n 0) `+ `-) 0 n)))", "<lambda `n `((if (> n 0) `+ `-) 0 n)>"),
+            TEST(R"(abs -3)", "3"),
+            TEST(R"(list (abs -3) (abs 0) (abs 3))", "`(3 0 3)"),
+            TEST(R"(def `combine (\ `(f)
+                 `(\ `(x y)
+                 `(if (null? x) `nil
+                 `(f (list (car x) (car y))
+                 ((combine f) (cdr x) (cdr y)))))))",
+                 R"(<lambda `f `(\ `(x y) `(if (null? x) `nil `(f (list (car x) (car y)) ((combine f) (cdr x) (cdr y)))))>)"),
+            TEST(R"(def `zip (combine cons))",
+                    "<lambda `(x y) `(if (null? x) `nil `(f (list (car x) (car y)) ((combine f) (cdr x) (cdr y))))>"),
+            TEST(R"(zip (list 1 2 3 4) (list 5 6 7 8))", "`(`(1 5) `(2 6) `(3 7) `(4 8))"),
+            TEST(R"(def `riff-shuffle (\ `(deck) `(begin
+                 (def `take (\ `(n seq) `(if (<= n 0) `nil `(cons (car seq) (take (- n 1) (cdr seq))))))
+                 (def `drop (\ `(n seq) `(if (<= n 0) `seq `(drop (- n 1) (cdr seq)))))
+                 (def `mid (\ `(seq) `(/ (len seq) 2)))
+                 ((combine append) (take (mid deck) deck) (drop (mid deck) deck)))))",
+                 R"(<lambda `deck `(begin)"
+                 R"( (def `take (\ `(n seq) `(if (<= n 0) `nil `(cons (car seq) (take (- n 1) (cdr seq)))))))"
+                 R"( (def `drop (\ `(n seq) `(if (<= n 0) `seq `(drop (- n 1) (cdr seq))))))"
+                 R"( (def `mid (\ `seq `(/ (len seq) 2))))"
+                 R"( ((combine append) (take (mid deck) deck) (drop (mid deck) deck)))>)"),
+            TEST(R"(riff-shuffle (list 1 2 3 4 5 6 7 8))", "`(1 5 2 6 3 7 4 8)"),
+            TEST(R"((repeat riff-shuffle) (list 1 2 3 4 5 6 7 8))",  "`(1 3 5 7 2 4 6 8)"),
+            TEST(R"(riff-shuffle (riff-shuffle (riff-shuffle (list 1 2 3 4 5 6 7 8))))", "`(1 2 3 4 5 6 7 8)"),
+            TEST(R"(def `apply (\ `(item L) `(eval (cons item L))))", "<lambda `(item L) `(eval (cons item L))>"),
+            TEST(R"(apply + `(1 2 3))", "6"),
+            TEST(R"(def `sum (\ `n `(if (< n 2) `1 `(+ n (sum (- n 1))))))",
+                 "<lambda `n `(if (< n 2) `1 `(+ n (sum (- n 1))))>"),
+            TEST(R"(sum 10)", "55"),
+            TEST(R"(def `Y (\ `f `((\ `self `(f (\ `x `((self self) x)))) (\ `self `(f (\ `x `((self self) x)))))))",
+                 R"(<lambda `f `((\ `self `(f (\ `x `((self self) x)))) (\ `self `(f (\ `x `((self self) x)))))>)"),
+            TEST(R"(def `Y_fib (\ `f `(\ `n `(if (<= n 2) `1 `(+ (f (- n 1)) (f (- n 2)))))))",
+                 R"(<lambda `f `(\ `n `(if (<= n 2) `1 `(+ (f (- n 1)) (f (- n 2)))))>)"),
+            TEST(R"((Y Y_fib) 5)", "5"),
+            TEST(R"((def `range (\ `(a b) `(if (== a b) `nil `(cons a (range (+ a 1) b))))))",
+                "<lambda `(a b) `(if (== a b) `nil `(cons a (range (+ a 1) b)))>"),
+            TEST(R"(range 1 10)", "`(1 2 3 4 5 6 7 8 9)"),
+            TEST(R"(apply + (range 1 10))", "45"),
+            // 字节码编译：参数槽位、捕获的变量、运行时才知道的函数和运行时拼出来的代码
+            TEST(R"((\ `(x x) `x) 1 2)", "2"),
+            TEST(R"(((\ `(x) `(\ `(y) `(+ x y))) 3) 4)", "7"),
+            TEST(R"(((\ `(x) `(\ `(y) `(begin (def `x 10) (+ x y)))) 1) 2)", "12"),
+            TEST(R"(((if 0 `+ `-) 5 3))", "2"),
+            TEST(R"(def `qq quote)", R"(<subroutine "quote">)"),
+            TEST(R"(qq (undefined symbols))", "`(undefined symbols)"),
+            TEST(R"(eval (list + 1 2))", "3"),
+            TEST(R"(eval (list (\ `(x) `(* x x)) 9))", "81"),
+            TEST(R"(map (\ `(x) `(if (> x 2) `x `0)) (range 0 5))", "`(0 0 0 3 4)"),
+            TEST(R"(def `ys (range 0 3))", "`(0 1 2)"),
+            TEST(R"(cons 9 ys)", "`(9 0 1 2)"),
+            TEST(R"(ys)", "`(0 1 2)"),
+            TEST(R"(def `f (\ `x `(cons x `(1 2))))", "<lambda `x `(cons x `(1 2))>"),
+            TEST(R"(list (f 0) (f 5))", "`(`(0 1 2) `(5 1 2))"),
+            // 重新绑定的特殊形式按普通调用处理
+            TEST(R"((\ `(if x) `(if x `1 `2)) list 0)", "`(0 `1 `2)"),
+            TEST(R"((\ `(begin) `(begin 1 2)) +)", "3"),
+            TEST(R"(def `h (\ `(a) `(if a `1 `2)))", "<lambda `a `(if a `1 `2)>"),
+            TEST(R"((\ `(if) `(h 1)) (\ `(a b c) `(list 9 a)))", "`(9 1)"),
+            TEST(R"(h 0)", "2"),
+            TEST(R"(def `old-while while)", R"(<subroutine "while">)"),
+            TEST(R"(def `while (\ `(c b) `42))", "<lambda `(c b) `42>"),
+            TEST(R"(while `(< 1 2) `(+ 1 2))", "42"),
+            TEST(R"(def `while old-while)", R"(<subroutine "while">)"),
+            TEST(R"(begin (def `i 0) (while `(< i 3) `(def `i (+ i 1))) i)", "3"),
+            // 二元运算的快速路径，运算符被重新定义后照常调用
+            TEST(R"(list (- 10 4) (* 6 7) (/ 7 2) (< 1 2) (>= 2 3) (== 3 3) (!= 3 3))", "`(6 42 3 1 0 1 0)"),
+            TEST(R"(list (+ 1.5 2.0) (* 2.5 4.0) (< 1.5 2.5))", "`(3.5 10 1)"),
+            TEST(R"((\ `(x y) `(+ (* x x) (* y y))) 3 4)", "25"),
+            TEST(R"(+ 1 2.0)", ERR("invalid operator type")),
+            TEST(R"(def `plus +)", R"(<subroutine "+">)"),
+            TEST(R"(def `+ (\ `(a b) `(list a b)))", "<lambda `(a b) `(list a b)>"),
+            TEST(R"(+ 1 2)", "`(1 2)"),
+            TEST(R"((\ `(x) `(+ x 1)) 5)", "`(5 1)"),
+            TEST(R"(def `+ plus)", R"(<subroutine "+">)"),
+            TEST(R"(+ 1 2)", "3"),
+            TEST(R"((\ `(- a) `(- a 1)) * 6)", "6"),
+            TEST(R"(def `dec (\ `(n) `(- n 1)))", "<lambda `n `(- n 1)>"),
+            TEST(R"((\ `(-) `(dec 10)) +)", "11"),
+            TEST(R"(dec 10)", "9"),
+            TEST(R"(def `lt <)", R"(<subroutine "<">)"),
+            TEST(R"(def `< >)", R"(<subroutine ">">)"),
+            TEST(R"(if (< 1 2) `1 `2)", "2"),
+            TEST(R"(def `< lt)", R"(<subroutine "<">)"),
+            TEST(R"(if (< 1 2) `1 `2)", "1"),
+            // 批量创建和关键字选项
+            TEST(R"(boxes (list `pos (range 0 5) 10) `(size 0.4 0.4) `(mass 1))", "5"),
+            TEST(R"(boxes `(pos `(1 2) `(3 4 5)))", ERR("boxes requires vectors of the same size")),
+            TEST(R"(box `(pos 1 2) `(color 1))", ERR("[0001:016] box: unknown option")),
+            TEST(R"(box `(pos 1))", ERR("[0001:005] box: option pos requires 2 values")),
+            TEST(R"(box `(mass "heavy"))", ERR("[0001:005] box: invalid value of option mass")),
+            TEST(R"(box (list `size 1))", ERR("box: option size requires 2 values")),
+            TEST(R"(box 1)", ERR("[0001:005] box: expect option `(name value...)")),
+            TEST(R"(box (+ 1 2))", ERR("box: expect option `(name value...)")),
+            TEST(R"(def `zz `(pos 1 2))", "`(pos 1 2)"),
+            TEST(R"(box (cons 1 (append zz)))", ERR("box: unknown option")),
+            TEST(R"(box (cons `size (append `(pos) `(1 2))))", ERR("box: option size requires 2 values")),
+    };
+    auto i = 0;
+    auto failed = 0;
+    std::stringstream ss;
+    std::string ast, out;
+    // 每执行cycle条指令做一次增量回收，peak记录存活对象数的峰值
+    auto eval = [&](const std::string &code, int cycle, size_t &peak) {
+        vm.save();
+        try {
+            ast = code;
+            clib::cparser p(ast);
+            auto root = p.parse();
+            vm.prepare(root);
+            clib::cval *val;
+            peak = vm.count();
+            while (!(val = vm.run(cycle))) {
+                vm.gc_step(LISP_GC_STEP);
+                peak = std::max(peak, vm.count());
+            }
+            ss.str("");
+            clib::cast::print(root, 0, ss);
+            ast = ss.str();
+            ss.str("");
+            clib::cvm::print(val, ss);
+            out = ss.str();
+            vm.gc();
+        } catch (const std::exception &e) {
+            out = std::string("ERROR: ") + e.what();
+            vm.restore();
+            vm.gc();
+        }
+    };
+    auto check = [&](const std::string &right, bool ok) {
+        std::cout << "TEST #" << (++i) << "> ";
+        if (out == right && ok) {
+            std::cout << "[PASSED] " << ast << "  =>  " << out;
+        } else {
+            std::cout << "[ERROR ] " << ast << "  =>  " << out << "   REQUIRE: " << right;
+            failed++;
+        }
+        std::cout << std::endl;
+    };
+    size_t peak;
+    auto bodies = clib::world->get_bodies().size();
+    for (auto &code : codes) {
+        eval(std::get<0>(code), INT32_MAX, peak);
+        check(std::get<1>(code), true);
+    }
+    // boxes按向量的长度创建
+    std::cout << "TEST #" << (++i) << "> ";
+    if (clib::world->get_bodies().size() == bodies + 5) {
+        std::cout << "[PASSED] boxes created 5 bodies" << std::endl;
+    } else {
+        std::cout << "[ERROR ] boxes created " << clib::world->get_bodies().size() - bodies << " bodies" << std::endl;
+        failed++;
+    }
+    // 尾调用和while只占常数空间，递归建表与表长成正比：边运行边增量回收，存活对象数的峰值不超过给定值
+    auto mems = std::vector<std::tuple<std::string, std::string, size_t>>{
+            TEST_MEM(R"(def `loop (\ `(n) `(if (== n 0) `0 `(loop (- n 1)))))", "<lambda `n `(if (== n 0) `0 `(loop (- n 1)))>", 2000),
+            TEST_MEM(R"(loop 1000)", "0", 2000),
+            TEST_MEM(R"(loop 100000)", "0", 2000),
+            TEST_MEM(R"(def `ev (\ `(n) `(if (== n 0) `1 `(od (- n 1)))))", "<lambda `n `(if (== n 0) `1 `(od (- n 1)))>", 2000),
+            TEST_MEM(R"(def `od (\ `(n) `(if (== n 0) `0 `(ev (- n 1)))))", "<lambda `n `(if (== n 0) `0 `(ev (- n 1)))>", 2000),
+            TEST_MEM(R"(ev 100001)", "0", 2000),
+            TEST_MEM(R"(def `count (\ `(n) `(begin (def `t 0) (while `(> n 0) `(begin (def `t (+ t 1)) (def `n (- n 1)))) t)))",
+                     "<lambda `n `(begin (def `t 0) (while `(> n 0) `(begin (def `t (+ t 1)) (def `n (- n 1)))) t)>", 2000),
+            TEST_MEM(R"(count 1000)", "1000", 2000),
+            TEST_MEM(R"(count 100000)", "100000", 2000),
+            TEST_MEM(R"(len (range 0 100000))", "100000", 1000000),
+    };
+    for (auto &code : mems) {
+        eval(std::get<0>(code), LISP_CYCLE, peak);
+        auto limit = std::get<2>(code);
+        check(std::get<1>(code), peak <= limit);
+        if (peak > limit)
+            std::cout << "    peak " << peak << " objects, limit " << limit << std::endl;
+    }
+    std::cout << "==== ALL TEST PASSED [" << (i - failed) << "/" << i << "] ====" << std::endl;
+    delete clib::world;
+    return failed == 0 ? 0 : 1;
+}
@@ -11,56 +11,97 @@
 
 namespace clib {
     // 二维向量
+    // 全部在头文件中定义，热点循环里的运算可以内联，不必依赖链接时优化
     struct v2 {
         decimal x{0}, y{0}; // X、Y坐标
 
         // 构造函数
-        v2() = default;
+        constexpr v2() = default;
 
-        v2(decimal _x, decimal _y);
+        constexpr v2(decimal _x, decimal _y) : x(_x), y(_y) {}
 
-        v2(const v2 &v) = default;
+        constexpr v2(const v2 &v) = default;
 
         v2 &operator=(const v2 &v) = default;
 
-        v2 operator*(decimal d) const;
+        FORCE_INLINE constexpr v2 operator*(decimal d) const {
+            return {x * d, y * d};
+        }
 
-        v2 operator/(decimal d) const;
+        FORCE_INLINE constexpr v2 operator/(decimal d) const {
+            return {x / d, y / d};
+        }
 
-        v2 operator+(const v2 &v) const;
+        FORCE_INLINE constexpr v2 operator+(const v2 &v) const {
+            return {x + v.x, y + v.y};
+        }
 
-        v2 operator-(const v2 &v) const;
+        FORCE_INLINE constexpr v2 operator-(const v2 &v) const {
+            return {x - v.x, y - v.y};
+        }
 
-        v2 operator+(decimal d) const;
+        FORCE_INLINE constexpr v2 operator+(decimal d) const {
+            return {x + d, y + d};
+        }
 
-        v2 operator-(decimal d) const;
+        FORCE_INLINE constexpr v2 operator-(decimal d) const {
+            return {x - d, y - d};
+        }
 
-        v2 &operator+=(const v2 &v);
+        FORCE_INLINE v2 &operator+=(const v2 &v) {
+            x += v.x;
+            y += v.y;
+            return *this;
+        }
 
-        v2 &operator-=(const v2 &v);
+        FORCE_INLINE v2 &operator-=(const v2 &v) {
+            x -= v.x;
+            y -= v.y;
+            return *this;
+        }
 
-        friend v2 operator*(decimal d, const v2 &v);
+        friend FORCE_INLINE constexpr v2 operator*(decimal d, const v2 &v) {
+            return {d * v.x, d * v.y};
+        }
 
-        v2 operator-() const;
+        FORCE_INLINE constexpr v2 operator-() const {
+            return {-x, -y};
+        }
 
         // 叉乘
-        decimal cross(const v2 &v) const;
+        FORCE_INLINE constexpr decimal cross(const v2 &v) const {
+            return x * v.y - y * v.x;
+        }
 
         // 点乘
-        decimal dot(const v2 &v) const;
+        FORCE_INLINE constexpr decimal dot(const v2 &v) const {
+            return x * v.x + y * v.y;
+        }
 
-        decimal magnitude() const;
+        FORCE_INLINE decimal magnitude() const {
+            return std::sqrt(x * x + y * y);
+        }
 
-        decimal magnitude_square() const;
+        FORCE_INLINE constexpr decimal magnitude_square() const {
+            return x * x + y * y;
+        }
 
-        v2 normalize() const;
+        FORCE_INLINE v2 normalize() const {
+            return *this / magnitude();
+        }
 
         // 法线向量
-        v2 normal() const;
+        FORCE_INLINE v2 normal() const {
+            return N().normalize();
+        }
 
-        v2 N() const;
+        FORCE_INLINE constexpr v2 N() const {
+            return v2{y, -x};
+        }
 
-        bool zero(decimal d) const;
+        FORCE_INLINE constexpr bool zero(decimal d) const {
+            return (x < 0 ? -x : x) < d && (y < 0 ? -y : y) < d; // std::abs在C++14中不是constexpr
+        }
     };
 }
 
@@ -60,7 +60,7 @@ namespace clib {
 
             contact.mass_normal = 1 / kn;
             contact.mass_tangent = 1 / kt;
-            contact.bias = -kBiasFactor / dt * std::min(0.0, contact.separation + kAllowedPenetration);
+            contact.bias = -kBiasFactor / dt * std::min<decimal>(0, contact.separation + kAllowedPenetration);
         }
     }
 
@@ -74,7 +74,7 @@ namespace clib {
 
             auto vn = dot(dv, _normal);
             auto dpn = (-vn + contact.bias) * contact.mass_normal;
-            dpn = std::max(contact.pn + dpn, 0.0) - contact.pn;
+            dpn = std::max<decimal>(contact.pn + dpn, 0) - contact.pn;
 
             decimal friction = std::sqrt(a->get_friction() * b->get_friction());
             auto vt = dot(dv, tangent);
@@ -9,74 +9,233 @@
 #include <limits>
 #include <cmath>
 #include <array>
+#include <cassert>
 
 #define DISALLOW_COPY_AND_ASSIGN(TypeName) \
     TypeName(const TypeName&) = delete; \
     const TypeName& operator=(const TypeName&) = delete;
 #define MAKE_ID(a, b) (((a)<(b))?(((a)<<16)|(b)):(((b)<<16)|(a)))
+#ifndef USE_FLOAT
+#define USE_FLOAT 0 // 1为单精度浮点，可在编译选项中指定
+#endif
+#ifdef _MSC_VER
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
 
 namespace clib {
 
+#if USE_FLOAT
+    using decimal = float;
+#else
     using decimal = double;
+#endif
 
+    // 全部在头文件中定义，热点循环里的运算可以内联，不必依赖链接时优化
     struct vec2 {
         decimal x, y;
 
-        vec2();
-        vec2(decimal, decimal);
-        decimal operator[](size_t idx);
-        const decimal &operator[](size_t idx) const;
-        vec2 operator-() const;
-        decimal magnitude() const;;
+        constexpr vec2() : x(0), y(0) {}
+        constexpr vec2(decimal _x, decimal _y) : x(_x), y(_y) {}
+
+        decimal operator[](size_t idx) {
+            assert(idx <= 2);
+            return idx == 0 ? x : y;
+        }
+
+        const decimal &operator[](size_t idx) const {
+            assert(idx <= 2);
+            return idx == 0 ? x : y;
+        }
+
+        FORCE_INLINE constexpr vec2 operator-() const {
+            return vec2{-x, -y};
+        }
+
+        FORCE_INLINE decimal magnitude() const {
+            return std::sqrt(x * x + y * y);
+        }
+
         vec2 normal() const;
         vec2 normalized() const;
     };
 
-    vec2 operator+(const vec2 &a, const vec2 &b);
-    void operator+=(vec2 &a, const vec2 &b);
-    vec2 operator-(const vec2 &a, const vec2 &b);
-    void operator-=(vec2 &a, const vec2 &b);
-    vec2 operator*(const vec2 &a, decimal b);
-    vec2 operator*(decimal a, const vec2 &b);
-    void operator*=(vec2 &a, decimal b);
-    vec2 operator/(const vec2 &a, decimal b);
-    void operator/=(vec2 &a, decimal b);
-    decimal dot(const vec2 &a, const vec2 &b);
-    decimal cross(const vec2 &a, const vec2 &b);
-    vec2 cross(decimal a, const vec2 &b);
+    FORCE_INLINE constexpr vec2 operator+(const vec2 &a, const vec2 &b) {
+        return {a.x + b.x, a.y + b.y};
+    }
+
+    FORCE_INLINE void operator+=(vec2 &a, const vec2 &b) {
+        a = a + b;
+    }
+
+    FORCE_INLINE constexpr vec2 operator-(const vec2 &a, const vec2 &b) {
+        return {a.x - b.x, a.y - b.y};
+    }
+
+    FORCE_INLINE void operator-=(vec2 &a, const vec2 &b) {
+        a = a - b;
+    }
+
+    FORCE_INLINE constexpr vec2 operator*(const vec2 &a, decimal b) {
+        return {a.x * b, a.y * b};
+    }
+
+    FORCE_INLINE constexpr vec2 operator*(decimal a, const vec2 &b) {
+        return b * a;
+    }
+
+    FORCE_INLINE void operator*=(vec2 &a, decimal b) {
+        a = a * b;
+    }
+
+    FORCE_INLINE constexpr vec2 operator/(const vec2 &a, decimal b) {
+        return {a.x / b, a.y / b};
+    }
+
+    FORCE_INLINE void operator/=(vec2 &a, decimal b) {
+        a = a / b;
+    }
+
+    FORCE_INLINE constexpr decimal dot(const vec2 &a, const vec2 &b) {
+        return a.x * b.x + a.y * b.y;
+    }
+
+    FORCE_INLINE constexpr decimal cross(const vec2 &a, const vec2 &b) {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    FORCE_INLINE constexpr vec2 cross(decimal a, const vec2 &b) {
+        return a * vec2(-b.y, b.x);
+    }
+
+    FORCE_INLINE vec2 vec2::normal() const {
+        return vec2(y, -x).normalized();
+    }
+
+    FORCE_INLINE vec2 vec2::normalized() const {
+        return *this / magnitude();
+    }
 
     struct mat22 {
         std::array<vec2, 2> _mat;
 
-        mat22();
-        mat22(const std::array<vec2, 2> &mat);
-        mat22(decimal a, decimal b, decimal c, decimal d);
-        decimal det() const;
-        mat22 inverse() const;
-        mat22 transpose() const;
-        vec2 &operator[](size_t idx);
-        const vec2 &operator[](size_t idx) const;
+        constexpr mat22() : mat22(0, 0, 0, 0) {}
+        constexpr mat22(const std::array<vec2, 2> &mat) : _mat(mat) {}
+        constexpr mat22(decimal a, decimal b, decimal c, decimal d) : _mat{{{a, b}, {c, d}}} {}
+
+        FORCE_INLINE constexpr decimal det() const {
+            return _mat[0].x * _mat[1].y - _mat[0].y * _mat[1].x;
+        }
+
+        constexpr mat22 inverse() const;
+
+        FORCE_INLINE constexpr mat22 transpose() const {
+            return mat22{_mat[0].x, _mat[1].x, _mat[0].y, _mat[1].y};
+        }
+
+        vec2 &operator[](size_t idx) {
+            assert(idx <= 2);
+            return _mat[idx];
+        }
+
+        const vec2 &operator[](size_t idx) const {
+            assert(idx <= 2);
+            return _mat[idx];
+        }
+
         static const mat22 I;
     };
 
-    mat22 operator+(const mat22 &a, const mat22 &b);
-    void operator+=(mat22 &a, const mat22 &b);
-    mat22 operator+(const mat22 &a, decimal b);
-    mat22 operator+(decimal a, const mat22 &b);
-    void operator+=(mat22 &a, decimal b);
-    mat22 operator-(const mat22 &a, const mat22 &b);
-    void operator-=(mat22 &a, const mat22 &b);
-    mat22 operator-(decimal a, const mat22 &b);
-    void operator-=(mat22 &a, decimal b);
-    mat22 operator*(const mat22 &a, decimal b);
-    mat22 operator*(decimal a, const mat22 &b);
-    void operator*=(mat22 &a, decimal b);
-    vec2 operator*(const vec2 &a, const mat22 &b);
-    vec2 operator*(const mat22 &a, const vec2 &b);
-    void operator*=(vec2 &a, const mat22 &b);
-    mat22 operator*(const mat22 &a, const mat22 &b);
-    void operator*=(mat22 &a, const mat22 &b);
-    mat22 rotate(decimal a);
+    FORCE_INLINE constexpr mat22 operator+(const mat22 &a, const mat22 &b) {
+        return {a._mat[0].x + b._mat[0].x, a._mat[0].y + b._mat[0].y,
+                a._mat[1].x + b._mat[1].x, a._mat[1].y + b._mat[1].y};
+    }
+
+    FORCE_INLINE void operator+=(mat22 &a, const mat22 &b) {
+        a = a + b;
+    }
+
+    FORCE_INLINE constexpr mat22 operator+(const mat22 &a, decimal b) {
+        return a + mat22(b, 0, 0, b);
+    }
+
+    FORCE_INLINE constexpr mat22 operator+(decimal a, const mat22 &b) {
+        return b + a;
+    }
+
+    FORCE_INLINE void operator+=(mat22 &a, decimal b) {
+        a = a + b;
+    }
+
+    FORCE_INLINE constexpr mat22 operator-(const mat22 &a, const mat22 &b) {
+        return {a._mat[0].x - b._mat[0].x, a._mat[0].y - b._mat[0].y,
+                a._mat[1].x - b._mat[1].x, a._mat[1].y - b._mat[1].y};
+    }
+
+    FORCE_INLINE void operator-=(mat22 &a, const mat22 &b) {
+        a = a - b;
+    }
+
+    FORCE_INLINE constexpr mat22 operator-(const mat22 &a, decimal b) {
+        return a - mat22(b, 0, 0, b);
+    }
+
+    FORCE_INLINE constexpr mat22 operator-(decimal a, const mat22 &b) {
+        return mat22(a, 0, 0, a) - b;
+    }
+
+    FORCE_INLINE void operator-=(mat22 &a, decimal b) {
+        a = a - b;
+    }
+
+    FORCE_INLINE constexpr mat22 operator*(const mat22 &a, decimal b) {
+        return {a._mat[0].x * b, a._mat[0].y * b,
+                a._mat[1].x * b, a._mat[1].y * b};
+    }
+
+    FORCE_INLINE constexpr mat22 operator*(decimal a, const mat22 &b) {
+        return b * a;
+    }
+
+    FORCE_INLINE void operator*=(mat22 &a, decimal b) {
+        a = a * b;
+    }
+
+    FORCE_INLINE constexpr vec2 operator*(const vec2 &a, const mat22 &b) {
+        return {a.x * b._mat[0].x + a.y * b._mat[1].x,
+                a.x * b._mat[0].y + a.y * b._mat[1].y};
+    }
+
+    FORCE_INLINE constexpr vec2 operator*(const mat22 &a, const vec2 &b) {
+        return {a._mat[0].x * b.x + a._mat[0].y * b.y,
+                a._mat[1].x * b.x + a._mat[1].y * b.y};
+    }
+
+    FORCE_INLINE void operator*=(vec2 &a, const mat22 &b) {
+        a = a * b;
+    }
+
+    FORCE_INLINE constexpr mat22 operator*(const mat22 &a, const mat22 &b) {
+        return {a._mat[0].x * b._mat[0].x + a._mat[0].y * b._mat[1].x,
+                a._mat[0].x * b._mat[0].y + a._mat[0].y * b._mat[1].y,
+                a._mat[1].x * b._mat[0].x + a._mat[1].y * b._mat[1].x,
+                a._mat[1].x * b._mat[0].y + a._mat[1].y * b._mat[1].y};
+    }
+
+    FORCE_INLINE void operator*=(mat22 &a, const mat22 &b) {
+        a = a * b;
+    }
+
+    FORCE_INLINE constexpr mat22 mat22::inverse() const {
+        return (1 / det()) * mat22(_mat[1].y, -_mat[0].y, -_mat[1].x, _mat[0].x);
+    }
+
+    FORCE_INLINE mat22 rotate(decimal theta) {
+        const auto _sin = std::sin(theta);
+        const auto _cos = std::cos(theta);
+        return mat22{_cos, -_sin, _sin, _cos};
+    }
 
     const auto inf = std::numeric_limits<clib::decimal>::infinity();
 }